@@ -60,7 +60,10 @@
 #include <string>
 #include <map>
 #include <sstream>
+#include <variant>
+#include <type_traits>
 #include <boost/lexical_cast.hpp>
+#include <boost/container/small_vector.hpp>
 
 //===================================================================================================================================
 // Facility to throw errors that can easily be converted to an informative pop-up floater for the user.
@@ -172,47 +175,101 @@
 /**
  * Arguments for AIAlert::Error.
  *
- * A wrapper around a `std::map` (translate::format_map_t) to allow constructing a dictionary on one line by doing:
+ * A flat list of key/value pairs (converted to a translate::format_map_t when needed) to allow constructing a dictionary on one line by doing:
  *
  * @{AIArgs("[ARG1]", arg1)("[ARG2]", arg2)("[ARG3]", arg3)...}
  *
  * Here the arguments are serialized into characters by using argX.print_on if
  * that exists, otherwise by using boost::lexical_cast<std::string>.
+ *
+ * Arithmetic arguments are stored as is and only serialized when the map is
+ * requested (operator*), which normally only happens when the alert is printed.
+ * Strings are copied and other arguments are serialized immediately, because
+ * they might not exist anymore by the time the alert is printed.
+ * Up to four arguments are stored without allocating memory for the list.
  */
 class AIArgs
 {
   private:
-    translate::format_map_t mArgs;    ///< The underlying replacement map.
+    using value_type = std::variant<std::string, long long, unsigned long long, char, float, double, long double>;
+
+    struct Arg
+    {
+      std::string mKey;
+      value_type mValue;
+    };
+
+    boost::container::small_vector<Arg, 4> mArgs;     ///< The replacements.
+
+    // Replace the value of key if it already exists, otherwise add it.
+    void set(char const* key, value_type&& value)
+    {
+      for (Arg& arg : mArgs)
+        if (arg.mKey == key)
+        {
+          arg.mValue = std::move(value);
+          return;
+        }
+      mArgs.push_back({key, std::move(value)});
+    }
+
+    // Convert replacement to something that can be stored in a value_type.
+    template<typename T>
+    static value_type capture(T const& replacement)
+    {
+      // boost::lexical_cast doesn't work when T only has a print_on method.
+      if constexpr (utils::has_print_on::has_print_on<T const>)
+      {
+        std::ostringstream oss;
+        replacement.print_on(oss);
+        return oss.str();
+      }
+      else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>)
+        return static_cast<char>(replacement);
+      else if constexpr (std::is_same_v<T, bool> || (std::is_integral_v<T> && std::is_signed_v<T>))
+        return static_cast<long long>(replacement);
+      else if constexpr (std::is_integral_v<T>)
+        return static_cast<unsigned long long>(replacement);
+      else if constexpr (std::is_floating_point_v<T>)
+        return replacement;
+      else if constexpr (std::is_constructible_v<std::string, T const&>)
+        // No need to call boost::lexical_cast when it already is a std::string or a char const*.
+        return std::string(replacement);
+      else
+        return boost::lexical_cast<std::string>(replacement);
+    }
+
+    // Serialize a stored value.
+    static std::string format(value_type const& value)
+    {
+      return std::visit([](auto const& v) -> std::string {
+          if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::string>)
+            return v;
+          else
+            return boost::lexical_cast<std::string>(v);
+        }, value);
+    }
 
   public:
     /// Construct an empty map.
     AIArgs() { }
     /// Construct a map with a single replacement.
-    // boost::lexical_cast doesn't work when T only has a print_on method.
-    template<typename T, typename std::enable_if<!utils::has_print_on::has_print_on<T const>, int>::type = 0>
-    AIArgs(char const* key, T const& replacement) { mArgs[key] = boost::lexical_cast<std::string>(replacement); }
-    template<typename T, typename std::enable_if<utils::has_print_on::has_print_on<T const>, int>::type = 0>
-    AIArgs(char const* key, T const& replacement) { std::ostringstream oss; replacement.print_on(oss); mArgs[key] = oss.str(); }
+    template<typename T>
+    AIArgs(char const* key, T const& replacement) { set(key, capture(replacement)); }
     /// Add another replacement.
-    template<typename T, typename std::enable_if<!utils::has_print_on::has_print_on<T const>, int>::type = 0>
-    AIArgs& operator()(char const* key, T const& replacement) { mArgs[key] = boost::lexical_cast<std::string>(replacement); return *this; }
-    template<typename T, typename std::enable_if<utils::has_print_on::has_print_on<T const>, int>::type = 0>
-    AIArgs& operator()(char const* key, T const& replacement) { std::ostringstream oss; replacement.print_on(oss); mArgs[key] = oss.str(); return *this; }
-
-    /// Accessor, returns the underlaying map.
-    translate::format_map_t const& operator*() const { return mArgs; }
+    template<typename T>
+    AIArgs& operator()(char const* key, T const& replacement) { set(key, capture(replacement)); return *this; }
+
+    /// Accessor, returns the replacements as a map.
+    translate::format_map_t operator*() const
+    {
+      translate::format_map_t result;
+      for (Arg const& arg : mArgs)
+        result.emplace(arg.mKey, format(arg.mValue));
+      return result;
+    }
 };
 
-// No need to call boost::lexical_cast when it already is a std::string or a char const*.
-/// Map @a replacement to @a key. Specialization for `std::string`.
-template<> inline AIArgs::AIArgs(char const* key, std::string const& replacement) { mArgs[key] = replacement; }
-/// Map @a replacement to @a key. Specialization for `char const*`.
-template<> inline AIArgs::AIArgs(char const* key, char const* const& replacement) { mArgs[key] = replacement; }
-/// Map @a replacement to @a key. Specialization for `std::string`.
-template<> inline AIArgs& AIArgs::operator()(char const* key, std::string const& replacement) { mArgs[key] = replacement; return *this; }
-/// Map @a replacement to @a key. Specialization for `char const*`.
-template<> inline AIArgs& AIArgs::operator()(char const* key, char const* const& replacement) { mArgs[key] = replacement; return *this; }
-
 namespace AIAlert {
 
 /// Whether or not an alert should be modal.
@@ -299,8 +356,8 @@ class Line
     // These are to be used like: translate::getString(line.getXmlDesc(), line.args()) and prepend with a \n if prepend_newline() returns true.
     /// Return the xml key.
     std::string const& getXmlDesc() const { return mXmlDesc; }
-    /// Accessor for the replacement map.
-    translate::format_map_t const& args() const { return *mArgs; }
+    /// Accessor for the replacement map (the arguments are serialized by this call).
+    translate::format_map_t args() const { return *mArgs; }
     /// Returns true a new line must be prepended before this line.
     bool prepend_newline() const { return mNewline; }
 
@@ -0,0 +1,142 @@
+// Benchmark of throwing and catching an AIAlert::Error versus the previous AIArgs.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. AIAlert_bench.cxx utils/AIAlert.cxx
+//
+// It measures THROW_ALERT with one to four replacements (an int, a double, a std::string
+// and an unsigned long), caught and never rendered. The previous AIArgs, that serialized
+// every argument with boost::lexical_cast into a std::map when the alert was thrown, is
+// copied below and thrown with the same macro, in an exception that stores its lines in
+// the same way as AIAlert::Error.
+
+#include "sys.h"
+#include "utils/AIAlert.h"
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include "debug.h"
+
+namespace {
+
+// The previous implementation of AIArgs.
+class OldAIArgs
+{
+  private:
+    translate::format_map_t mArgs;
+
+  public:
+    OldAIArgs() { }
+    template<typename T>
+    OldAIArgs(char const* key, T const& replacement) { mArgs[key] = boost::lexical_cast<std::string>(replacement); }
+    template<typename T>
+    OldAIArgs& operator()(char const* key, T const& replacement) { mArgs[key] = boost::lexical_cast<std::string>(replacement); return *this; }
+    translate::format_map_t const& operator*() const { return mArgs; }
+};
+
+template<> OldAIArgs& OldAIArgs::operator()(char const* key, std::string const& replacement) { mArgs[key] = replacement; return *this; }
+
+// What AIAlert::Line and AIAlert::Error stored, with OldAIArgs.
+struct OldLine
+{
+  bool mNewline;
+  std::string mXmlDesc;
+  OldAIArgs mArgs;
+  AIAlert::alert_line_type_nt mType;
+};
+
+class OldError : public std::exception
+{
+  private:
+    std::deque<OldLine> mLines;
+    AIAlert::modal_nt mModal;
+    bool mErrorCode;
+
+  public:
+    OldError(AIAlert::Prefix const& prefix, AIAlert::modal_nt type, std::string const& xml_desc, OldAIArgs const& args) : mModal(type), mErrorCode(false)
+    {
+      if (prefix) mLines.push_back(OldLine{false, prefix.str(), {}, prefix.type()});
+      mLines.push_back(OldLine{false, xml_desc, args, AIAlert::normal});
+    }
+};
+
+using clock_type = std::chrono::steady_clock;
+
+int volatile s_sink;
+
+std::string const s_name = "some_file.txt";
+
+// Not inlined, so that the alert is really thrown out of a function.
+[[gnu::noinline]] void throw_new(int replacements, int i)
+{
+  switch (replacements)
+  {
+    case 1:
+      THROW_ALERT("Failed at [A]", AIArgs("[A]", i));
+    case 2:
+      THROW_ALERT("Failed at [A] after [B] seconds", AIArgs("[A]", i)("[B]", 2.5));
+    case 3:
+      THROW_ALERT("Failed at [A] after [B] seconds reading [C]", AIArgs("[A]", i)("[B]", 2.5)("[C]", s_name));
+    default:
+      THROW_ALERT("Failed at [A] after [B] seconds reading [C] at offset [D]", AIArgs("[A]", i)("[B]", 2.5)("[C]", s_name)("[D]", 123456789UL));
+  }
+}
+
+[[gnu::noinline]] void throw_old(int replacements, int i)
+{
+  switch (replacements)
+  {
+    case 1:
+      THROW_ALERT_CLASS(OldError, "Failed at [A]", OldAIArgs("[A]", i));
+    case 2:
+      THROW_ALERT_CLASS(OldError, "Failed at [A] after [B] seconds", OldAIArgs("[A]", i)("[B]", 2.5));
+    case 3:
+      THROW_ALERT_CLASS(OldError, "Failed at [A] after [B] seconds reading [C]", OldAIArgs("[A]", i)("[B]", 2.5)("[C]", s_name));
+    default:
+      THROW_ALERT_CLASS(OldError, "Failed at [A] after [B] seconds reading [C] at offset [D]", OldAIArgs("[A]", i)("[B]", 2.5)("[C]", s_name)("[D]", 123456789UL));
+  }
+}
+
+// Return the fastest of five rounds.
+template<typename Exception>
+double nanoseconds_per_throw(void (*thrower)(int, int), int replacements)
+{
+  constexpr int count = 200000;
+  double best = 0;
+  for (int round = 0; round < 5; ++round)
+  {
+    int caught = 0;
+    auto const start = clock_type::now();
+    for (int i = 0; i < count; ++i)
+    {
+      try
+      {
+        thrower(replacements, i);
+      }
+      catch (Exception const&)
+      {
+        ++caught;
+      }
+    }
+    double const ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / count;
+    s_sink = caught;
+    if (round == 0 || ns < best)
+      best = ns;
+  }
+  return best;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  for (int replacements = 1; replacements <= 4; ++replacements)
+    std::cout << replacements << " replacement(s): " << std::fixed << std::setprecision(0) <<
+      "std::map + lexical_cast " << std::setw(5) << nanoseconds_per_throw<OldError>(throw_old, replacements) << " ns, " <<
+      "AIArgs " << std::setw(5) << nanoseconds_per_throw<AIAlert::Error>(throw_new, replacements) << " ns" << std::endl;
+}
@@ -0,0 +1,110 @@
+// Benchmark of AIBiasedRefCount versus AIRefCount.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. AIBiasedRefCount_bench.cxx utils/AIRefCount.cxx utils/threading/EpochReclamation.cxx
+//
+// It measures, per pointer, the cost of copying a boost::intrusive_ptr and of releasing
+// the copy on the owner thread, and the cost of handing objects to another thread that
+// releases the last reference.
+
+#include "sys.h"
+#include "utils/AIRefCount.h"
+#include <boost/intrusive_ptr.hpp>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Shared : AIRefCount { int m_value = 0; };
+struct Biased : AIBiasedRefCount { int m_value = 0; };
+
+using clock_type = std::chrono::steady_clock;
+
+double nanoseconds(clock_type::duration duration, long count)
+{
+  return std::chrono::duration<double, std::nano>(duration).count() / count;
+}
+
+template<typename T>
+[[gnu::noinline]] void copy(std::vector<boost::intrusive_ptr<T>> const& source, std::vector<boost::intrusive_ptr<T>>& destination)
+{
+  destination = source;
+}
+
+template<typename T>
+[[gnu::noinline]] void release(std::vector<boost::intrusive_ptr<T>>& pointers)
+{
+  pointers.clear();
+}
+
+// Copy and release pointers to objects that were created by the current thread.
+template<typename T>
+void owner_thread(char const* name)
+{
+  constexpr int number_of_objects = 1000;
+  constexpr int rounds = 20000;
+  std::vector<boost::intrusive_ptr<T>> source, destination;
+  for (int i = 0; i < number_of_objects; ++i)
+    source.push_back(new T);
+  destination.reserve(number_of_objects);
+
+  clock_type::duration copy_time{}, release_time{};
+  for (int r = 0; r < rounds; ++r)
+  {
+    auto start = clock_type::now();
+    copy(source, destination);
+    auto copied = clock_type::now();
+    release(destination);
+    release_time += clock_type::now() - copied;
+    copy_time += copied - start;
+  }
+  long const count = long{rounds} * number_of_objects;
+  std::cout << std::left << std::setw(18) << name << std::fixed << std::setprecision(2) <<
+    "copy: " << nanoseconds(copy_time, count) << " ns, release: " << nanoseconds(release_time, count) << " ns" << std::endl;
+}
+
+// Create objects and hand the last reference to another thread, that releases it.
+template<typename T>
+void hand_off(char const* name)
+{
+  constexpr int number_of_objects = 100000;
+  constexpr int rounds = 10;
+  auto start = clock_type::now();
+  for (int r = 0; r < rounds; ++r)
+  {
+    std::vector<boost::intrusive_ptr<T>> objects;
+    objects.reserve(number_of_objects);
+    for (int i = 0; i < number_of_objects; ++i)
+    {
+      boost::intrusive_ptr<T> object = new T;
+      boost::intrusive_ptr<T> copy = object;
+      objects.push_back(std::move(copy));
+    }
+    std::thread([moved = std::move(objects)]() mutable { moved.clear(); }).join();
+    AIBiasedRefCount::process_pending();
+  }
+  std::cout << std::left << std::setw(18) << name << std::fixed << std::setprecision(1) <<
+    "hand-off: " << nanoseconds(clock_type::now() - start, long{rounds} * number_of_objects) << " ns per object" << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  for (int i = 0; i < 3; ++i)
+  {
+    owner_thread<Shared>("AIRefCount");
+    owner_thread<Biased>("AIBiasedRefCount");
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    hand_off<Shared>("AIRefCount");
+    hand_off<Biased>("AIBiasedRefCount");
+  }
+}
@@ -0,0 +1,224 @@
+// Multi-threaded stress test of AIBiasedRefCount.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -fsanitize=thread -I. AIBiasedRefCount_tst.cxx utils/AIRefCount.cxx utils/threading/EpochReclamation.cxx
+//
+// and run it; it prints "Success!" or aborts with an error message.
+
+#include "sys.h"
+#include "utils/AIRefCount.h"
+#include <boost/intrusive_ptr.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+std::atomic<int> s_live{0};
+
+struct Object : AIBiasedRefCount
+{
+  int m_value;
+  Object(int value) : m_value(value) { s_live.fetch_add(1, std::memory_order_relaxed); }
+  ~Object() { s_live.fetch_sub(1, std::memory_order_relaxed); }
+};
+
+using ObjectPtr = boost::intrusive_ptr<Object>;
+
+void check(bool condition, char const* what)
+{
+  if (!condition)
+  {
+    std::cerr << "FAILED: " << what << " (live objects: " << s_live.load() << ")" << std::endl;
+    std::abort();
+  }
+}
+
+// A mailbox through which threads pass objects to each other.
+struct Mailbox
+{
+  std::mutex m_mutex;
+  std::deque<ObjectPtr> m_objects;
+
+  void put(ObjectPtr const& object)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_objects.push_back(object);
+  }
+
+  ObjectPtr take()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_objects.empty())
+      return {};
+    ObjectPtr object = std::move(m_objects.front());
+    m_objects.pop_front();
+    return object;
+  }
+};
+
+// Three threads create objects, pass copies to both other threads and release their own
+// references, while the other threads copy and release the same objects; the last reference
+// is released by the owner or by any other thread, before or after the owner merged.
+void test_create_copy_release()
+{
+  constexpr int number_of_threads = 3;
+  constexpr int objects_per_thread = 100000;
+  Mailbox mailboxes[number_of_threads];
+  std::atomic<int> finished{0};
+
+  auto worker = [&](int t){
+    for (int i = 0; i < objects_per_thread; ++i)
+    {
+      ObjectPtr object = new Object(i);
+      ObjectPtr copy = object;
+      for (int other = 1; other < number_of_threads; ++other)
+        mailboxes[(t + other) % number_of_threads].put(copy);
+      if (i % 3 == 0)
+        object.reset();         // Release the owner reference while the others are (possibly) still using it.
+      // Use and release the objects that were received.
+      for (ObjectPtr received = mailboxes[t].take(); received; received = mailboxes[t].take())
+      {
+        ObjectPtr received_copy = received;
+        check(received_copy->m_value >= 0, "corrupted object");
+      }
+    }
+    finished.fetch_add(1);
+    // Keep receiving until all threads finished sending.
+    while (finished.load() < number_of_threads)
+    {
+      while (mailboxes[t].take())
+        ;
+      std::this_thread::yield();
+    }
+    while (mailboxes[t].take())
+      ;
+    // Merge objects that were queued by other threads.
+    AIBiasedRefCount::process_pending();
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < number_of_threads; ++t)
+    threads.emplace_back(worker, t);
+  worker(0);
+  for (auto& thread : threads)
+    thread.join();
+  // The other threads might have queued objects of the main thread after it called process_pending.
+  AIBiasedRefCount::process_pending();
+  check(s_live == 0, "test_create_copy_release: objects leaked");
+}
+
+// Objects created by a thread that exits while other threads still hold references to them.
+void test_owner_exit()
+{
+  std::vector<ObjectPtr> objects;
+  std::thread owner([&]{
+    for (int i = 0; i < 1000; ++i)
+    {
+      ObjectPtr object = new Object(i);
+      ObjectPtr copy = object;
+      objects.push_back(copy);
+    }
+  });
+  owner.join();
+  check(s_live == 1000, "test_owner_exit: objects deleted too early");
+  std::vector<ObjectPtr> copies = objects;
+  objects.clear();
+  check(s_live == 1000, "test_owner_exit: objects deleted too early");
+  copies.clear();
+  check(s_live == 0, "test_owner_exit: objects leaked");
+}
+
+// The owner hands its only reference to another thread that releases it: the object is
+// queued for the owner, and deleted when the owner processes its queue.
+void test_hand_off()
+{
+  std::vector<ObjectPtr> objects;
+  for (int i = 0; i < 1000; ++i)
+    objects.push_back(new Object(i));
+  std::thread([moved = std::move(objects)]() mutable { moved.clear(); }).join();
+  check(s_live == 1000, "test_hand_off: object deleted by a thread that is not the owner");
+  AIBiasedRefCount::process_pending();
+  check(s_live == 0, "test_hand_off: objects leaked");
+}
+
+// Another thread queues objects while the owner is still running, then the owner exits
+// without calling process_pending: the queue must be processed at thread exit.
+void test_queued_at_exit()
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool created = false;
+  bool released = false;
+  std::vector<ObjectPtr> objects;
+  std::thread owner([&]{
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (int i = 0; i < 1000; ++i)
+        objects.push_back(new Object(i));
+      created = true;
+    }
+    cv.notify_all();
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]{ return released; });
+  });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]{ return created; });
+    objects.clear();              // Queues every object for the owner.
+    check(s_live == 1000, "test_queued_at_exit: object deleted by a thread that is not the owner");
+    released = true;
+  }
+  cv.notify_all();
+  owner.join();
+  check(s_live == 0, "test_queued_at_exit: objects leaked");
+}
+
+// A producer/consumer pair where the consumer releases the last reference of most objects
+// while the producer keeps creating (and releasing references of) other objects.
+void test_queueing()
+{
+  Mailbox mailbox;
+  std::atomic<bool> stop{false};
+  std::thread consumer([&]{
+    for (;;)
+    {
+      bool stopping = stop;     // Read before take(), so that the last objects aren't missed.
+      ObjectPtr object = mailbox.take();
+      if (!object && stopping)
+        break;
+    }
+  });
+  for (int i = 0; i < 200000; ++i)
+  {
+    ObjectPtr object = new Object(i);
+    ObjectPtr copy = object;
+    mailbox.put(copy);
+  }
+  stop = true;
+  consumer.join();
+  AIBiasedRefCount::process_pending();
+  check(s_live == 0, "test_queueing: objects leaked");
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  test_owner_exit();
+  test_hand_off();
+  test_queued_at_exit();
+  test_queueing();
+  test_create_copy_release();
+
+  std::cout << "Success!" << std::endl;
+}
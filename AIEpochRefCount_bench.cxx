@@ -0,0 +1,115 @@
+// Benchmark of AIEpochRefCount versus AIRefCount.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. AIEpochRefCount_bench.cxx utils/AIRefCount.cxx utils/threading/EpochReclamation.cxx
+//
+// It measures the cost of releasing the last reference of objects that own some heap
+// memory: the average and the distribution of single releases, and the cost of an EpochGuard.
+// AIEpochRefCount is measured in both collect modes: collect_inline, where every 64th release
+// deletes a batch, and collect_deferred, where a reclaimer thread calls collect() every
+// millisecond.
+
+#include "sys.h"
+#include "utils/AIRefCount.h"
+#include "utils/threading/EpochReclamation.h"
+#include <boost/intrusive_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t payload_size = 4096;
+
+struct Shared : AIRefCount { std::unique_ptr<char[]> m_payload{new char[payload_size]}; };
+struct Epoch : AIEpochRefCount { std::unique_ptr<char[]> m_payload{new char[payload_size]}; };
+
+using clock_type = std::chrono::steady_clock;
+
+double nanoseconds(clock_type::duration duration)
+{
+  return std::chrono::duration<double, std::nano>(duration).count();
+}
+
+template<typename T>
+void release(char const* name, bool deferred = false)
+{
+  constexpr int number_of_objects = 200000;
+  std::vector<boost::intrusive_ptr<T>> objects;
+  objects.reserve(number_of_objects);
+  for (int i = 0; i < number_of_objects; ++i)
+    objects.push_back(new T);
+
+  std::atomic<bool> stop{false};
+  std::thread reclaimer;
+  if (deferred)
+  {
+    utils::threading::epoch::set_collect_mode(utils::threading::epoch::collect_deferred);
+    reclaimer = std::thread([&]{
+      while (!stop)
+      {
+        utils::threading::epoch::collect();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+  }
+
+  std::vector<double> latencies;
+  latencies.reserve(number_of_objects);
+  auto const start = clock_type::now();
+  for (auto& object : objects)
+  {
+    auto before = clock_type::now();
+    object.reset();
+    latencies.push_back(nanoseconds(clock_type::now() - before));
+  }
+  double const total = nanoseconds(clock_type::now() - start);
+  if (deferred)
+  {
+    stop = true;
+    reclaimer.join();
+    utils::threading::epoch::set_collect_mode(utils::threading::epoch::collect_inline);
+  }
+  // Delete what is still retired, outside of the measurement.
+  utils::threading::epoch::flush();
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p){ return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+  std::cout << std::left << std::setw(26) << name << std::fixed << std::setprecision(1) <<
+    "release: " << total / number_of_objects << " ns average (including timing), median " << percentile(0.5) <<
+    " ns, p99 " << percentile(0.99) << " ns, p99.9 " << percentile(0.999) << " ns, max " << latencies.back() << " ns" << std::endl;
+}
+
+void guard()
+{
+  constexpr int count = 10000000;
+  auto const start = clock_type::now();
+  for (int i = 0; i < count; ++i)
+  {
+    utils::threading::EpochGuard guard;
+    asm volatile ("" ::: "memory");
+  }
+  std::cout << std::left << std::setw(26) << "EpochGuard" << std::fixed << std::setprecision(2) <<
+    "enter+leave: " << nanoseconds(clock_type::now() - start) / count << " ns" << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  for (int i = 0; i < 3; ++i)
+  {
+    release<Shared>("AIRefCount");
+    release<Epoch>("AIEpochRefCount");
+    release<Epoch>("AIEpochRefCount, deferred", true);
+  }
+  guard();
+}
@@ -0,0 +1,158 @@
+// Multi-threaded stress test of epoch-based reclamation (utils/threading/EpochReclamation.h) and AIEpochRefCount.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O1 -g -fsanitize=address -I. AIEpochRefCount_tst.cxx utils/AIRefCount.cxx utils/threading/EpochReclamation.cxx
+//
+// and run it; it prints "Success!" or aborts with an error message. Readers dereference raw
+// pointers inside an EpochGuard while writers replace and release or retire those objects,
+// so any object that is deleted too early is reported by the address sanitizer.
+
+#include "sys.h"
+#include "utils/AIRefCount.h"
+#include "utils/intrusive_ptr.h"
+#include "utils/threading/EpochReclamation.h"
+#include <boost/intrusive_ptr.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+std::atomic<int> s_live{0};
+
+constexpr int s_magic = 12345;
+
+// An object that is released through boost::intrusive_ptr or utils::intrusive_ptr.
+struct Object : AIEpochRefCount
+{
+  int m_magic = s_magic;
+  Object() { s_live.fetch_add(1, std::memory_order_relaxed); }
+  ~Object() { m_magic = 0; s_live.fetch_sub(1, std::memory_order_relaxed); }
+};
+
+// An object that is retired explicitly.
+struct Node
+{
+  int m_magic = s_magic;
+  Node() { s_live.fetch_add(1, std::memory_order_relaxed); }
+  ~Node() { m_magic = 0; s_live.fetch_sub(1, std::memory_order_relaxed); }
+};
+
+void check(bool condition, char const* what)
+{
+  if (!condition)
+  {
+    std::cerr << "FAILED: " << what << " (live objects: " << s_live.load() << ")" << std::endl;
+    std::abort();
+  }
+}
+
+using namespace utils::threading;
+
+// Releasing the last reference retires the object; it is deleted by flush().
+void test_deferred_release()
+{
+  boost::intrusive_ptr<Object> p = new Object;
+  utils::intrusive_ptr<Object> q(p.get());
+  p.reset();
+  q.reset();
+  check(s_live == 1, "test_deferred_release: object deleted immediately");
+  epoch::flush();
+  check(s_live == 0, "test_deferred_release: object not deleted by flush");
+}
+
+// Objects retired by a thread that exits are deleted by another thread.
+void test_orphans()
+{
+  std::thread([]{
+    std::vector<boost::intrusive_ptr<Object>> objects;
+    for (int i = 0; i < 10; ++i)
+      objects.push_back(new Object);
+  }).join();
+  check(s_live == 10, "test_orphans: objects deleted immediately");
+  epoch::flush();
+  check(s_live == 0, "test_orphans: orphaned objects not deleted");
+}
+
+// A thread in collect_deferred mode leaves deleting to other threads, unless too many bags are waiting.
+void test_deferred_mode()
+{
+  std::thread([]{
+    epoch::set_collect_mode(epoch::collect_deferred);
+    for (int i = 0; i < 1000; ++i)
+      boost::intrusive_ptr<Object> object = new Object;
+    check(s_live == 1000, "test_deferred_mode: objects deleted by a thread in collect_deferred mode");
+    // Nobody collects, so eventually this thread must.
+    for (int i = 0; i < 200000; ++i)
+      epoch::retire(new Node);
+    check(s_live < 100000, "test_deferred_mode: a thread in collect_deferred mode never collects");
+  }).join();
+  // Two epochs must pass before the bags can be deleted.
+  for (int i = 0; i < 3; ++i)
+    epoch::collect();
+  check(s_live == 0, "test_deferred_mode: objects not deleted by collect");
+}
+
+// Three readers use the current objects while two writers keep replacing them.
+void test_readers_and_writers()
+{
+  std::atomic<Object*> current_object;
+  std::atomic<Node*> current_node{new Node};
+  boost::intrusive_ptr<Object> holder = new Object;
+  current_object = holder.get();
+  std::atomic<bool> stop{false};
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t)
+    readers.emplace_back([&]{
+      while (!stop)
+      {
+        EpochGuard guard;
+        Object* object = current_object.load(std::memory_order_acquire);
+        Node* node = current_node.load(std::memory_order_acquire);
+        {
+          EpochGuard nested;
+          check(object->m_magic == s_magic, "test_readers_and_writers: object deleted while in use");
+        }
+        check(node->m_magic == s_magic, "test_readers_and_writers: node deleted while in use");
+      }
+    });
+
+  std::thread node_writer([&]{
+    for (int i = 0; i < 100000; ++i)
+      epoch::retire(current_node.exchange(new Node, std::memory_order_acq_rel));
+  });
+  for (int i = 0; i < 100000; ++i)
+  {
+    boost::intrusive_ptr<Object> object = new Object;
+    current_object.store(object.get(), std::memory_order_release);
+    holder = object;            // Releases the previous object, which is retired.
+  }
+  node_writer.join();
+  stop = true;
+  for (auto& reader : readers)
+    reader.join();
+
+  holder.reset();
+  epoch::retire(current_node.load());
+  epoch::flush();
+  check(s_live == 0, "test_readers_and_writers: objects leaked");
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  test_deferred_release();
+  test_orphans();
+  test_deferred_mode();
+  test_readers_and_writers();
+
+  std::cout << "Success!" << std::endl;
+}
@@ -0,0 +1,148 @@
+#include "sys.h"
+#include "AIRefCount.h"
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// The per thread state of AIBiasedRefCount.
+struct ThreadQueue : AIBiasedRefCount::ThreadState
+{
+  std::mutex m_mutex;
+  std::vector<AIBiasedRefCount const*> m_queue;        // Objects that must be merged by this thread. Protected by m_mutex.
+  bool m_exited{false};                                 // Set when the thread exited. Protected by m_mutex.
+  std::atomic<int> m_references{1};                     // One for the thread, plus one for every object that wasn't merged yet.
+};
+
+// Set when the current thread is exiting; after that objects created by this thread are never biased.
+constinit thread_local bool s_exiting = false;
+
+} // namespace
+
+// Destroyed when the thread exits.
+struct AIBiasedRefCount::ThreadStateOwner
+{
+  ThreadQueue* m_thread_state;
+
+  ThreadStateOwner() : m_thread_state(new ThreadQueue) { }
+
+  ~ThreadStateOwner()
+  {
+    // From now on this thread no longer writes m_biased of any object: it uses the shared count, like any other thread.
+    s_this_thread_state = nullptr;
+    s_exiting = true;
+    {
+      std::lock_guard<std::mutex> lock(m_thread_state->m_mutex);
+      m_thread_state->m_exited = true;
+    }
+    // Merge everything that was queued so far; objects that are queued after this are merged by the thread that queues them.
+    process(m_thread_state);
+    unregister_owner(m_thread_state);
+  }
+};
+
+//static
+AIBiasedRefCount::ThreadState* AIBiasedRefCount::register_owner()
+{
+  ThreadState* thread_state = s_this_thread_state;
+  if (AI_UNLIKELY(!thread_state))
+  {
+    if (s_exiting)
+      return nullptr;
+    static thread_local ThreadStateOwner s_thread_state_owner;
+    thread_state = s_this_thread_state = s_thread_state_owner.m_thread_state;
+  }
+  static_cast<ThreadQueue*>(thread_state)->m_references.fetch_add(1, std::memory_order_relaxed);
+  return thread_state;
+}
+
+//static
+void AIBiasedRefCount::unregister_owner(ThreadState* thread_state)
+{
+  ThreadQueue* thread_queue = static_cast<ThreadQueue*>(thread_state);
+  if (thread_queue->m_references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    delete thread_queue;
+}
+
+// Merge m_biased into m_shared. Returns true if the caller must delete the object.
+//
+// This must be called by the owner thread, or by any thread after the owner exited.
+// If dequeued is true then this object was just removed from the queue of the owner.
+bool AIBiasedRefCount::merge(bool dequeued) const
+{
+  // Once m_shared is updated below, another thread can delete this object: no member may be accessed after that.
+  ThreadState* const owner = m_owner;
+  int biased = m_biased.load(std::memory_order_relaxed);
+  uint32_t delta;
+  if (biased == s_merged_biased)
+  {
+    // The owner already merged this object while it was queued.
+    ASSERT(dequeued);
+    delta = -s_queued;
+  }
+  else
+  {
+    m_biased.store(s_merged_biased, std::memory_order_relaxed);
+    delta = static_cast<uint32_t>(biased) + s_merged - (dequeued ? s_queued : 0);
+  }
+  uint32_t shared = m_shared.fetch_add(delta, std::memory_order_acq_rel) + delta;
+  // If the object is (still) queued then it is finished when it is dequeued.
+  if ((shared & s_queued))
+    return false;
+  unregister_owner(owner);
+  // Paranoia check. This should never fail.
+  ASSERT(count_of(shared) >= 0);
+  return count_of(shared) == 0;
+}
+
+// Called by a thread other than the owner that set s_queued.
+void AIBiasedRefCount::enqueue() const
+{
+  // The owner can't be deleted before this object is merged.
+  ThreadQueue* owner = static_cast<ThreadQueue*>(m_owner);
+  bool exited;
+  {
+    std::lock_guard<std::mutex> lock(owner->m_mutex);
+    exited = owner->m_exited;
+    if (!exited)
+    {
+      owner->m_queue.push_back(this);
+      owner->m_pending.store(true, std::memory_order_relaxed);
+    }
+  }
+  // Nobody will process the queue if the owner already exited: merge this object here.
+  // Don't queue it and then process the queue, because another thread could process it first,
+  // merge this object and delete owner along with the last merged object.
+  if (exited && merge(true))
+  {
+    DEBUG_ONLY(m_shared = s_deleted);
+    delete this;
+  }
+}
+
+//static
+void AIBiasedRefCount::process(ThreadState* thread_state)
+{
+  ThreadQueue* thread_queue = static_cast<ThreadQueue*>(thread_state);
+  std::vector<AIBiasedRefCount const*> queue;
+  {
+    std::lock_guard<std::mutex> lock(thread_queue->m_mutex);
+    queue.swap(thread_queue->m_queue);
+    thread_queue->m_pending.store(false, std::memory_order_relaxed);
+  }
+  // Every object holds a reference to thread_queue, so the last merge might delete it.
+  for (AIBiasedRefCount const* object : queue)
+    if (object->merge(true))
+    {
+      DEBUG_ONLY(object->m_shared = s_deleted);
+      delete object;
+    }
+}
+
+//static
+void AIBiasedRefCount::process_pending()
+{
+  ThreadState* thread_state = s_this_thread_state;
+  if (thread_state && thread_state->m_pending.load(std::memory_order_relaxed))
+    process(thread_state);
+}
@@ -28,7 +28,10 @@
 #pragma once
 
 #include "utils/FuzzyBool.h"
+#include "utils/macros.h"
+#include "utils/threading/EpochReclamation.h"
 #include <atomic>
+#include <cstdint>
 #include <boost/intrusive_ptr.hpp>
 #include "debug.h"
 
@@ -219,3 +222,258 @@ class AIRefCount
   }
 #endif
 };
+
+// AIEpochRefCount
+//
+// Like AIRefCount, but when the last reference is released the object is retired
+// (see utils/threading/EpochReclamation.h) instead of being deleted immediately.
+// The object is then deleted later, in a batch, once no thread is inside a critical
+// section (utils::threading::EpochGuard) that it entered before the object was released.
+//
+// This allows lock-free readers to use raw pointers (loaded inside a critical section)
+// to objects of which another thread might release the last reference at the same time.
+//
+// AIEpochRefCount uses the collect mode of the thread that releases the last reference.
+// In the default mode, collect_inline, that thread deletes a batch of expired objects
+// every so many releases. To move destruction and deallocation off a thread completely,
+// that thread should call utils::threading::epoch::set_collect_mode(collect_deferred),
+// and another thread should call utils::threading::epoch::collect() regularly.
+//
+// The deferred deletion applies to boost::intrusive_ptr, utils::intrusive_ptr and
+// allow_deletion, as long as they are used with a pointer to (a class derived from)
+// AIEpochRefCount; calling allow_deletion through a pointer to AIRefCount still deletes
+// the object immediately.
+//
+// Usage:
+//
+// class MyClass : public AIEpochRefCount
+// {
+// };
+//
+class AIEpochRefCount;
+inline void intrusive_ptr_release(AIEpochRefCount const* ptr);
+
+class AIEpochRefCount : public AIRefCount
+{
+ public:
+  friend void intrusive_ptr_release(AIEpochRefCount const* ptr)
+  {
+    ptr->allow_deletion();
+  }
+
+  // Like AIRefCount::allow_deletion, but the object is retired instead of deleted when the last reference is removed.
+  // If defer_delete is true then the object must be deleted or retired by the caller iff the returned value is count.
+  int allow_deletion(bool defer_delete = false, int count = 1) const
+  {
+    int prev_count = AIRefCount::allow_deletion(true, count);
+    if (prev_count == count && !defer_delete)
+    {
+      DEBUG_ONLY(mark_deleted());
+      utils::threading::epoch::retire(this);
+    }
+    return prev_count;
+  }
+};
+
+// AIBiasedRefCount
+//
+// An opt-in alternative to AIRefCount for objects that are (mostly) only used by
+// the thread that created them: the owner thread. Derive from AIBiasedRefCount
+// instead of from AIRefCount to use it; the API is the same.
+//
+// The owner thread counts its references in a counter that only it writes, so that
+// copying a boost::intrusive_ptr there does not need an atomic read-modify-write.
+// All other threads use an atomic shared counter. Once the owner no longer holds
+// any reference, both counters are merged and from then on the object behaves
+// like an AIRefCount: every thread uses the shared counter.
+//
+// If another thread releases the last shared reference while the owner still
+// didn't merge (for example, because the owner passed a boost::intrusive_ptr
+// to that thread, or just released it) then the object is queued for the owner,
+// which merges it (and deletes it if that was the last reference) the next time
+// it releases a reference of any AIBiasedRefCount, when it calls
+// AIBiasedRefCount::process_pending() or when the thread exits; if the owner
+// thread already exited then the object is merged by the releasing thread.
+// Hence, a thread that hands objects to other threads and then blocks for a
+// long time should call process_pending() when it wakes up, or the deletion
+// of those objects is delayed.
+//
+// The owner thread is identified by a pointer to a per thread state (that contains
+// the queue) rather than by aithreadid, because that has to be a thread_local anyway.
+//
+// The return values of inhibit_deletion and allow_deletion are not exact (the total
+// count isn't known without merging); they are only meant for debugging purposes anyway.
+// allow_deletion(true) still returns count iff the caller must delete the object,
+// but if the last reference is removed by merging (by the owner, see above) then
+// the object is deleted there.
+//
+class AIBiasedRefCount;
+inline void intrusive_ptr_add_ref(AIBiasedRefCount const* ptr);
+inline void intrusive_ptr_release(AIBiasedRefCount const* ptr);
+
+class AIBiasedRefCount
+{
+ public:
+  // The part of the per thread state that is used inline; the rest is in AIRefCount.cxx.
+  struct ThreadState
+  {
+    std::atomic<bool> m_pending{false};         // Set when objects were queued for this thread.
+  };
+
+ private:
+  // The layout of m_shared: a 30-bit count (plus s_count_bias) and two flags.
+  static constexpr uint32_t s_count_mask = 0x3fffffff;
+  static constexpr uint32_t s_count_bias = 0x20000000;  // The shared count can become negative before merging.
+  static constexpr uint32_t s_merged = 0x40000000;      // Set once m_biased has been merged into m_shared.
+  static constexpr uint32_t s_queued = 0x80000000;      // Set while the object is queued for the owner to merge.
+  static constexpr int s_merged_biased = -1;            // The value of m_biased after merging.
+#if CW_DEBUG
+  static constexpr uint32_t s_deleted = s_merged | s_queued | 0x1de1e7ed;       // A magic number.
+#endif
+
+  // The state of the current thread, or nullptr if no object was created by this thread yet (or it is exiting).
+  static inline constinit thread_local ThreadState* s_this_thread_state = nullptr;
+
+  ThreadState* const m_owner;                   // The state of the thread that created this object (or nullptr).
+  mutable std::atomic<int> m_biased;            // The references counted by the owner thread; only written by that thread.
+  mutable std::atomic<uint32_t> m_shared;       // The references counted by other threads, plus flags.
+
+  static int count_of(uint32_t shared) { return static_cast<int>(shared & s_count_mask) - static_cast<int>(s_count_bias); }
+
+  bool is_owner() const { return m_owner == s_this_thread_state && m_owner; }
+
+  void add_ref(int count) const
+  {
+    int biased = m_biased.load(std::memory_order_relaxed);
+    if (AI_LIKELY(is_owner() && biased != s_merged_biased))
+      m_biased.store(biased + count, std::memory_order_relaxed);
+    else
+      m_shared.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  // Remove count references. Returns true if the caller must delete the object.
+  bool release(int count) const
+  {
+    if (is_owner())
+    {
+      int biased = m_biased.load(std::memory_order_relaxed);
+      if (AI_LIKELY(biased >= count))
+      {
+        m_biased.store(biased - count, std::memory_order_relaxed);
+        // If merge() returns false then another thread might delete this object; don't access any member after it.
+        ThreadState* const owner = m_owner;
+        bool last = biased == count && merge();
+        if (AI_UNLIKELY(owner->m_pending.load(std::memory_order_relaxed)))
+          process_pending();
+        return last;
+      }
+      if (biased != s_merged_biased)
+      {
+        // The owner releases references that were counted as shared.
+        uint32_t prev = m_shared.fetch_sub(count, std::memory_order_release);
+        return count_of(prev) - count <= 0 && merge();
+      }
+    }
+    uint32_t prev = m_shared.load(std::memory_order_relaxed);
+    uint32_t next;
+    do
+    {
+      next = prev - count;
+      // If the shared count of an object that wasn't merged yet drops to zero (or below) then it must be merged by its owner.
+      // Setting s_queued in the same atomic operation guarantees that the owner doesn't delete the object before it is queued.
+      if (!(prev & s_merged) && count_of(next) <= 0)
+        next |= s_queued;
+    }
+    // Acquire (instead of a separate fence when the count drops to zero), so that thread sanitizers see the synchronization too;
+    // on x86 this costs the same.
+    while (!m_shared.compare_exchange_weak(prev, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+    if (AI_UNLIKELY(!(prev & (s_merged | s_queued)) && (next & s_queued)))
+      enqueue();
+    else if (next == s_merged + s_count_bias)
+      return true;
+    return false;
+  }
+
+  struct ThreadStateOwner;
+
+  bool merge(bool dequeued = false) const;
+  void enqueue() const;
+  static void process(ThreadState* thread_state);
+  static ThreadState* register_owner();
+  static void unregister_owner(ThreadState* thread_state);
+
+ public:
+  friend void intrusive_ptr_add_ref(AIBiasedRefCount const* ptr)
+  {
+    ptr->add_ref(1);
+  }
+
+  friend void intrusive_ptr_release(AIBiasedRefCount const* ptr)
+  {
+    if (ptr->release(1))
+    {
+      DEBUG_ONLY(ptr->m_shared = s_deleted);
+      delete ptr;
+    }
+  }
+
+  // See AIRefCount::inhibit_deletion.
+  int inhibit_deletion(DEBUG_ONLY(bool can_cause_immediate_allow_deletion = true)) const
+  {
+    int prev_count = read_count_racy();
+    add_ref(1);
+    ASSERT(!can_cause_immediate_allow_deletion || prev_count > 0);
+    return prev_count;
+  }
+
+  // See AIRefCount::allow_deletion.
+  int allow_deletion(bool defer_delete = false, int count = 1) const
+  {
+    // Do not call this function with a count of 0.
+    ASSERT(count > 0);
+    int prev_count = read_count_racy();
+    if (!release(count))
+      return prev_count > count ? prev_count : count + 1;
+    if (!defer_delete)
+    {
+      DEBUG_ONLY(m_shared = s_deleted);
+      delete this;
+    }
+    return count;
+  }
+
+  // Merge the objects that other threads queued for the current thread.
+  static void process_pending();
+
+ private:
+  // You should use inhibit_deletion / allow_deletion.
+  void intrusive_ptr_add_ref(AIBiasedRefCount const*);
+  void intrusive_ptr_release(AIBiasedRefCount const*);
+
+ protected:
+  AIBiasedRefCount() : m_owner(register_owner()), m_biased(m_owner ? 0 : s_merged_biased), m_shared(s_count_bias | (m_owner ? 0 : s_merged)) { }
+  AIBiasedRefCount(AIBiasedRefCount const&) : AIBiasedRefCount() { }
+  virtual ~AIBiasedRefCount() { if (m_biased.load(std::memory_order_relaxed) != s_merged_biased) unregister_owner(m_owner); }
+  AIBiasedRefCount& operator=(AIBiasedRefCount const&) { return *this; }
+  void swap(AIBiasedRefCount&) { }
+
+ public:
+  // Returns true if there is only one reference to this object left.
+  // If this function returns true it is therefore guaranteed to stay true,
+  // but if it returns false it might become true shortly afterwards.
+  utils::FuzzyBool unique() const { return read_count_racy() == 1 ? fuzzy::True : fuzzy::WasFalse; }
+
+#if CW_DEBUG
+  // Pretty unreliable, but sometimes useful.
+  bool is_destructed() const { return m_shared.load(std::memory_order_relaxed) == s_deleted; }
+  // Used when deferred deleting an object.
+  void mark_deleted() const { m_shared = s_deleted; }
+#endif
+
+  // The returned value suffers from race conditions and is not stable.
+  int read_count_racy() const
+  {
+    int biased = m_biased.load(std::memory_order_relaxed);
+    return (biased == s_merged_biased ? 0 : biased) + count_of(m_shared.load(std::memory_order_relaxed));
+  }
+};
@@ -0,0 +1,124 @@
+#include "sys.h"
+#include "ConcurrentDictionary.h"
+#include <algorithm>
+#include <cstring>
+
+namespace utils {
+
+ConcurrentDictionaryBase::ConcurrentDictionaryBase() : m_size(0), m_char_free(nullptr), m_char_free_size(0)
+{
+  for (auto& segment : m_segments)
+    segment.store(nullptr, std::memory_order_relaxed);
+  m_tables.emplace_back(std::make_unique<Table>(2 * first_segment_size));
+  m_table.store(m_tables.back().get(), std::memory_order_release);
+}
+
+ConcurrentDictionaryBase::~ConcurrentDictionaryBase()
+{
+  for (auto& segment : m_segments)
+    delete [] segment.load(std::memory_order_relaxed);
+}
+
+size_t ConcurrentDictionaryBase::add_extra_word(std::string_view const& word)
+{
+  return add_word(word, false);
+}
+
+size_t ConcurrentDictionaryBase::add_word(std::string_view word, bool allow_duplicate)
+{
+  std::lock_guard<std::mutex> lock(m_writer_mutex);
+
+  uint64_t const hash = hash_word(word);
+  size_t existing = find(word, hash);
+  if (existing != not_found && !allow_duplicate)
+    return existing;
+
+  size_t const index = m_size.load(std::memory_order_relaxed);
+  ASSERT(index < 0xffffffff);
+  auto [segment, offset] = segment_offset(index);
+  std::string_view* entries = m_segments[segment].load(std::memory_order_relaxed);
+  if (!entries)
+  {
+    entries = new std::string_view[first_segment_size << segment];
+    m_segments[segment].store(entries, std::memory_order_release);
+  }
+  entries[offset] = store_characters(word);
+  m_size.store(index + 1, std::memory_order_release);
+
+  // Duplicates are not added to the table: lookup keeps returning the first index.
+  if (existing == not_found)
+  {
+    Table* table = m_table.load(std::memory_order_relaxed);
+    if (2 * (table->m_used + 1) > table->m_mask + 1)
+    {
+      grow_table();
+      table = m_table.load(std::memory_order_relaxed);
+    }
+    insert_into_table(*table, hash, index);
+  }
+  return index;
+}
+
+size_t ConcurrentDictionaryBase::find(std::string_view word, uint64_t hash) const
+{
+  Table const* table = m_table.load(std::memory_order_relaxed);
+  for (size_t slot = hash & table->m_mask;; slot = (slot + 1) & table->m_mask)
+  {
+    uint64_t entry = table->m_slots[slot].load(std::memory_order_relaxed);
+    if (entry == 0)
+      return not_found;
+    if ((entry >> 32) == (hash >> 32))
+    {
+      size_t index = (entry & 0xffffffff) - 1;
+      if (this->word(index) == word)
+        return index;
+    }
+  }
+}
+
+std::string_view ConcurrentDictionaryBase::store_characters(std::string_view word)
+{
+  if (word.size() > m_char_free_size)
+  {
+    size_t block_size = std::max(char_block_size, word.size());
+    m_char_blocks.emplace_back(new char[block_size]);
+    m_char_free = m_char_blocks.back().get();
+    m_char_free_size = block_size;
+  }
+  char* stored = m_char_free;
+  std::memcpy(stored, word.data(), word.size());
+  m_char_free += word.size();
+  m_char_free_size -= word.size();
+  return { stored, word.size() };
+}
+
+//static
+void ConcurrentDictionaryBase::insert_into_table(Table& table, uint64_t hash, size_t index)
+{
+  size_t slot = hash & table.m_mask;
+  while (table.m_slots[slot].load(std::memory_order_relaxed) != 0)
+    slot = (slot + 1) & table.m_mask;
+  // Publish the word (this synchronizes with the acquire load in lookup).
+  table.m_slots[slot].store(((hash >> 32) << 32) | (index + 1), std::memory_order_release);
+  ++table.m_used;
+}
+
+void ConcurrentDictionaryBase::grow_table()
+{
+  Table const& old_table = *m_table.load(std::memory_order_relaxed);
+  auto new_table = std::make_unique<Table>(2 * (old_table.m_mask + 1));
+  for (size_t slot = 0; slot <= old_table.m_mask; ++slot)
+  {
+    uint64_t entry = old_table.m_slots[slot].load(std::memory_order_relaxed);
+    if (entry != 0)
+    {
+      size_t index = (entry & 0xffffffff) - 1;
+      insert_into_table(*new_table, hash_word(word(index)), index);
+    }
+  }
+  // The old table is retired, but kept alive because readers might still be using it.
+  m_table.store(new_table.get(), std::memory_order_release);
+  m_tables.push_back(std::move(new_table));
+}
+
+} // namespace utils
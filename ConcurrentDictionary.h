@@ -0,0 +1,190 @@
+#pragma once
+
+#include "log2.h"
+#include "macros.h"
+#include "StreamHasher.h"
+#include "debug.h"
+#include <string_view>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <exception>
+
+namespace utils {
+
+// A Dictionary (see Dictionary.h) that can be used by multiple threads without
+// wrapping it in a read/write lock.
+//
+// Readers (lookup, index and word) never block and do not write to shared memory.
+// Writers (add and add_extra_word) are serialized by a mutex.
+//
+// The words are stored in blocks that are never moved or freed (until the dictionary
+// is destroyed), and the string_view of each word is stored in an array of segments
+// of doubling size, so that a word, once added, is stable.
+//
+// The index is a linear probing hash table of atomic slots. Each slot packs the upper
+// 32 bits of the hash of a word with its index + 1 (0 means empty); a writer publishes
+// a new word with a single release store. When the table becomes half full a writer
+// builds a table twice the size and swaps it in with a single atomic pointer store;
+// the old table is retired but not freed until the dictionary is destroyed (since the
+// tables double in size, the retired tables take less memory than the current one).
+//
+// Because a reader might still be using a retired table, it can get NonExistingWord for
+// a word that was just added by another thread. Therefore add_extra_word returns the
+// existing index if the word was already added: two threads that race to add the same
+// word both get the same index.
+class ConcurrentDictionaryBase
+{
+ protected:
+  struct Table
+  {
+    size_t m_mask;                                      // The number of slots minus one.
+    std::unique_ptr<std::atomic<uint64_t>[]> m_slots;
+    size_t m_used;                                      // Only accessed by writers.
+
+    Table(size_t size) : m_mask(size - 1), m_slots(new std::atomic<uint64_t>[size]), m_used(0)
+    {
+      for (size_t i = 0; i < size; ++i)
+        m_slots[i].store(0, std::memory_order_relaxed);
+    }
+  };
+
+  static constexpr size_t first_segment_size = 64;
+  static constexpr int number_of_segments = 32;
+  static constexpr size_t char_block_size = 4096;
+
+  std::atomic<Table*> m_table;                                          // The current table.
+  std::array<std::atomic<std::string_view*>, number_of_segments> m_segments;    // Segment s has first_segment_size << s entries.
+  std::atomic<size_t> m_size;                                           // The number of words.
+
+  // Only accessed by writers.
+  std::mutex m_writer_mutex;
+  std::vector<std::unique_ptr<Table>> m_tables;                         // The current and all retired tables.
+  std::vector<std::unique_ptr<char[]>> m_char_blocks;                   // The storage of the characters of the words.
+  char* m_char_free;                                                    // The free space in the last block.
+  size_t m_char_free_size;
+
+ public:
+  ConcurrentDictionaryBase();
+  ~ConcurrentDictionaryBase();
+
+  // This should be called when lookup throws.
+  size_t add_extra_word(std::string_view const& word);
+
+  // Return the number of words in the dictionary.
+  size_t size() const { return m_size.load(std::memory_order_acquire); }
+
+  struct NonExistingWord : std::exception { };
+  size_t lookup(std::string_view const& word) const
+  {
+    //------------------------------------------------------------------------
+    // This is the part that has to be fast.
+    uint64_t const hash = hash_word(word);
+    Table const* table = m_table.load(std::memory_order_acquire);
+    for (size_t slot = hash & table->m_mask;; slot = (slot + 1) & table->m_mask)
+    {
+      uint64_t entry = table->m_slots[slot].load(std::memory_order_acquire);
+      if (AI_UNLIKELY(entry == 0))
+        break;
+      if ((entry >> 32) == (hash >> 32))
+      {
+        size_t index = (entry & 0xffffffff) - 1;
+        if (AI_LIKELY(this->word(index) == word))
+          return index;
+      }
+    }
+    //------------------------------------------------------------------------
+
+    throw NonExistingWord{};
+  }
+
+  // Index must be less than size() (or returned by lookup or add_extra_word).
+  std::string_view word(size_t index) const
+  {
+    auto [segment, offset] = segment_offset(index);
+    return m_segments[segment].load(std::memory_order_acquire)[offset];
+  }
+
+ protected:
+  static constexpr size_t not_found = static_cast<size_t>(-1);
+
+  // Add word and return its index. If the word already exists and allow_duplicate is false, return the existing index.
+  size_t add_word(std::string_view word, bool allow_duplicate);
+
+ private:
+  static uint64_t hash_word(std::string_view word)
+  {
+    return hasher::WyHash::hash(std::as_bytes(std::span{word.data(), word.size()}));
+  }
+
+  static std::pair<int, size_t> segment_offset(size_t index)
+  {
+    int segment = utils::log2(index / first_segment_size + 1);
+    return { segment, index - first_segment_size * ((size_t{1} << segment) - 1) };
+  }
+
+  // The following functions may only be called while m_writer_mutex is locked.
+  size_t find(std::string_view word, uint64_t hash) const;
+  std::string_view store_characters(std::string_view word);
+  static void insert_into_table(Table& table, uint64_t hash, size_t index);
+  void grow_table();
+};
+
+// Usage:
+//
+// enum enum_type {
+//   foo,
+//   bar,
+//   baz
+// };
+//
+// using index_type = utils::VectorIndex<enum_type>;
+//
+// ConcurrentDictionary<enum_type, index_type> dictionary;
+//
+// dictionary.add(foo, "Foo");
+// dictionary.add(bar, "Bar");
+// dictionary.add(baz, "Baz");
+//
+// And then from any number of threads:
+//
+// index_type i;
+// try
+// {
+//   i = dictionary.index(word);                   // Lock-free; throws when word is unknown.
+// }
+// catch (utils::ConcurrentDictionaryBase::NonExistingWord const&)
+// {
+//   i = dictionary.add_extra_word(word);          // Locks a mutex.
+// }
+//
+template<typename ENUM_TYPE, typename INDEX_TYPE>
+class ConcurrentDictionary : public ConcurrentDictionaryBase
+{
+ public:
+  using enum_type = ENUM_TYPE;
+  using index_type = INDEX_TYPE;
+
+  static_assert(std::is_convertible_v<ENUM_TYPE, size_t>, "ENUM_TYPE must be convertible to size_t.");
+  static_assert(std::is_constructible_v<index_type, size_t>, "INDEX_TYPE must be constructible from a size_t.");
+
+  // Pre-fill the dictionary with pre-defined words.
+  // This should be called for each enumerator in the enum sequentially.
+  void add(ENUM_TYPE index, std::string_view word)
+  {
+    // index must be sequential, starting with 0 and 1 larger every call.
+    ASSERT(this->size() == static_cast<size_t>(index));
+    this->add_word(word, true);
+  }
+
+  // Return a unique index for each unique word.
+  // If word was not added yet, then this function throws NonExistingWord and word should be passed to add_extra_word.
+  index_type index(std::string_view const& word) const { return static_cast<index_type>(this->lookup(word)); }
+};
+
+} // namespace utils
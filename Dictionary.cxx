@@ -1,22 +1,147 @@
 #include "sys.h"
 #include "Dictionary.h"
+#include <algorithm>
+#include <numeric>
 
 namespace utils {
 
-size_t DictionaryBase::add_new_unique_word(std::string&& word)
+size_t DictionaryBase::add_new_unique_word(std::string_view word)
 {
-  size_t index = m_unique_words.size();
-  m_unique_words.emplace_back(std::move(word));
-  std::string& stored_word = m_unique_words.back();
-  m_string_view_to_index.emplace(stored_word, index);
+  m_frozen = false;
+  size_t index = size();
+  // Keep the load factor below 7/8.
+  if ((index + 1) * 8 > m_ctrl.size() * 7)
+    grow_table();
+  uint64_t hash = hash_word(word);
+  // If the word already exists then lookup keeps returning the old index.
+  bool exists = find(word, hash) != not_found;
+  m_arena.append(word);
+  m_word_end.push_back(m_arena.size());
+  if (!exists)
+    insert_into_table(hash, index);
   return index;
 }
 
 size_t DictionaryBase::add_extra_word(std::string_view const& word)
 {
-  std::string extra_word(word);
-  add_new_data(m_unique_words.size(), extra_word);
-  return add_new_unique_word(std::move(extra_word));
+  add_new_data(size(), std::string{word});
+  return add_new_unique_word(word);
+}
+
+void DictionaryBase::insert_into_table(uint64_t hash, uint32_t index)
+{
+  size_t const group_mask = m_ctrl.size() / group_size - 1;
+  size_t group = hash & group_mask;
+  for (size_t step = 1;; ++step)
+  {
+    int8_t* ctrl = &m_ctrl[group * group_size];
+    if (unsigned int empty = match_empty(ctrl))
+    {
+      size_t slot = group * group_size + utils::ctz(empty);
+      m_ctrl[slot] = hash >> 57;
+      m_slots[slot] = index;
+      return;
+    }
+    group = (group + step) & group_mask;
+  }
+}
+
+void DictionaryBase::grow_table()
+{
+  size_t new_size = std::max(m_ctrl.size() * 2, group_size);
+  m_ctrl.assign(new_size, ctrl_empty);
+  m_slots.resize(new_size);
+  // Re-insert all words, in order, skipping duplicates (which were never in the table).
+  for (size_t index = 0; index < size(); ++index)
+  {
+    std::string_view w = word(index);
+    uint64_t hash = hash_word(w);
+    if (find(w, hash) == not_found)
+      insert_into_table(hash, index);
+  }
+}
+
+bool DictionaryBase::freeze()
+{
+  DoutEntering(dc::notice, "DictionaryBase::freeze() [" << this << "]");
+
+  m_frozen = false;
+
+  // Collect the hashes of all unique words (duplicates are not in the table).
+  std::vector<std::pair<uint64_t, uint32_t>> keys;      // hash, index.
+  for (size_t index = 0; index < size(); ++index)
+  {
+    std::string_view w = word(index);
+    uint64_t hash = hash_word(w);
+    if (find(w, hash) == index)
+      keys.emplace_back(hash, index);
+  }
+  size_t const n = keys.size();
+  if (n == 0)
+    return false;
+
+  // Two different words with the same 64-bit hash can't be separated.
+  std::sort(keys.begin(), keys.end());
+  for (size_t i = 1; i < n; ++i)
+    if (AI_UNLIKELY(keys[i - 1].first == keys[i].first))
+    {
+      Dout(dc::warning, "DictionaryBase::freeze: hash collision between \"" << word(keys[i - 1].second) << "\" and \"" << word(keys[i].second) << "\".");
+      return false;
+    }
+
+  // Distribute the keys over buckets, on average two per bucket.
+  size_t const number_of_buckets = (n + 1) / 2;
+  std::vector<std::vector<uint32_t>> buckets(number_of_buckets);       // Indices into keys.
+  for (uint32_t k = 0; k < n; ++k)
+    buckets[fast_range(keys[k].first, number_of_buckets)].push_back(k);
+
+  // Place the largest buckets first.
+  std::vector<uint32_t> order(number_of_buckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t b1, uint32_t b2){ return buckets[b1].size() > buckets[b2].size(); });
+
+  // Find for each bucket a displacement that maps all of its keys to free slots.
+  static constexpr uint32_t max_displacement = 1 << 24;
+  std::vector<uint32_t> displacements(number_of_buckets, 0);
+  std::vector<uint32_t> perfect_index(n);
+  std::vector<bool> taken(n, false);
+  std::vector<size_t> slots;
+  for (uint32_t b : order)
+  {
+    std::vector<uint32_t> const& bucket = buckets[b];
+    if (bucket.empty())
+      break;
+    uint32_t displacement = 0;
+    for (;; ++displacement)
+    {
+      if (AI_UNLIKELY(displacement == max_displacement))
+      {
+        Dout(dc::warning, "DictionaryBase::freeze: failed to find a displacement for bucket " << b << ".");
+        return false;
+      }
+      slots.clear();
+      for (uint32_t k : bucket)
+      {
+        size_t slot = perfect_slot(keys[k].first, displacement, n);
+        if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+          break;
+        slots.push_back(slot);
+      }
+      if (slots.size() == bucket.size())
+        break;
+    }
+    displacements[b] = displacement;
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+      taken[slots[i]] = true;
+      perfect_index[slots[i]] = keys[bucket[i]].second;
+    }
+  }
+
+  m_displacements = std::move(displacements);
+  m_perfect_index = std::move(perfect_index);
+  m_frozen = true;
+  return true;
 }
 
 } // namespace utils
@@ -1,45 +1,172 @@
 #pragma once
 
 #include "macros.h"
+#include "ctz.h"
+#include "StreamHasher.h"
 #include "debug.h"
 #include <string_view>
 #include <string>
-#include <unordered_map>
-#include <deque>
 #include <vector>
+#include <span>
+#include <cstdint>
 #include <exception>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace utils {
 
+// The words are stored back to back in a single string (m_arena) and looked up
+// through an open addressing hash table in the style of SwissTable:
+//
+// m_ctrl contains one control byte per slot: either ctrl_empty, or the top
+// seven bits of the hash of the word stored in that slot (the "tag").
+// The slots are grouped per group_size; a lookup loads the control bytes of
+// a whole group at once (with SSE2 if available) and only compares the words
+// of slots whose tag matches. A group that contains an empty slot ends the probe
+// sequence. Words are never removed, so there are no tombstones.
+//
+// Once all words are known, freeze() can be called to compile the words into
+// a minimal perfect hash (hash and displace): lookup then costs one hash, two
+// array reads and a final string compare. Adding a word after freeze() falls
+// back to the open addressing table (until freeze() is called again).
 class DictionaryBase
 {
  protected:
-  std::unordered_map<std::string_view, size_t> m_string_view_to_index;
-  std::deque<std::string> m_unique_words;       // This must be a random access container that can be accessed through an index and does not invalidate references.
+  static constexpr size_t group_size = 16;
+  static constexpr int8_t ctrl_empty = -128;    // Has the high bit set; tags are in the range [0, 127].
+
+  std::vector<int8_t> m_ctrl;                   // The control bytes, a multiple of group_size (or empty).
+  std::vector<uint32_t> m_slots;                // The index of the word stored in the corresponding slot.
+  std::string m_arena;                          // All words, concatenated.
+  std::vector<size_t> m_word_end;               // m_word_end[i] is the offset in m_arena one past the end of word i.
+
+  bool m_frozen = false;                        // Set when m_displacements and m_perfect_index are valid.
+  std::vector<uint32_t> m_displacements;        // The displacement of each bucket of the perfect hash.
+  std::vector<uint32_t> m_perfect_index;        // The index of the word that the perfect hash maps to each slot.
 
  protected:
-  size_t add_new_unique_word(std::string&& word);
+  size_t add_new_unique_word(std::string_view word);
 
  public:
   // This should be called when lookup throws.
   size_t add_extra_word(std::string_view const& word);
 
+  // Compile the current words into a minimal perfect hash, see above.
+  // Returns false if that failed (lookup then keeps using the open addressing table).
+  bool freeze();
+
+  // Return true if the dictionary is frozen (and no words were added after the last call to freeze()).
+  bool is_frozen() const { return m_frozen; }
+
+  // Return the number of words in the dictionary.
+  size_t size() const { return m_word_end.size(); }
+
   struct NonExistingWord : std::exception { };
   size_t lookup(std::string_view const& word) const
   {
     //------------------------------------------------------------------------
     // This is the part that has to be fast.
-    auto iter = m_string_view_to_index.find(word);
-    if (AI_LIKELY(iter != m_string_view_to_index.end()))
-      return iter->second;
+    uint64_t const hash = hash_word(word);
+    if (m_frozen)
+    {
+      uint32_t const displacement = m_displacements[fast_range(hash, m_displacements.size())];
+      size_t const index = m_perfect_index[perfect_slot(hash, displacement, m_perfect_index.size())];
+      if (AI_LIKELY(this->word(index) == word))
+        return index;
+    }
+    else if (size_t index = find(word, hash); AI_LIKELY(index != not_found))
+      return index;
     //------------------------------------------------------------------------
 
     throw NonExistingWord{};
   }
 
-  std::string const& word(int i) const { return m_unique_words[i]; }
+  std::string_view word(size_t i) const
+  {
+    size_t begin = i == 0 ? 0 : m_word_end[i - 1];
+    return { m_arena.data() + begin, m_word_end[i] - begin };
+  }
+
+ protected:
+  static constexpr size_t not_found = static_cast<size_t>(-1);
+
+  // Return the index of word, or not_found. hash must be hash_word(word).
+  size_t find(std::string_view word, uint64_t hash) const
+  {
+    if (AI_UNLIKELY(m_ctrl.empty()))
+      return not_found;
+    int8_t const tag = hash >> 57;
+    size_t const group_mask = m_ctrl.size() / group_size - 1;
+    size_t group = hash & group_mask;
+    for (size_t step = 1;; ++step)
+    {
+      int8_t const* ctrl = &m_ctrl[group * group_size];
+      for (unsigned int match = match_tag(ctrl, tag); match; match &= match - 1)
+      {
+        uint32_t index = m_slots[group * group_size + utils::ctz(match)];
+        if (AI_LIKELY(this->word(index) == word))
+          return index;
+      }
+      if (AI_LIKELY(match_empty(ctrl)))
+        return not_found;
+      group = (group + step) & group_mask;      // Triangular probing visits every group when the number of groups is a power of two.
+    }
+  }
+
+  // Map x uniformly onto [0, n) without a division.
+  static size_t fast_range(uint64_t x, size_t n)
+  {
+    return (static_cast<__uint128_t>(x) * n) >> 64;
+  }
+
+  // Map hash onto [0, n), scrambled by displacement.
+  static size_t perfect_slot(uint64_t hash, uint32_t displacement, size_t n)
+  {
+    uint64_t x = hash ^ (displacement * 0x9e3779b97f4a7c15);
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 29;
+    return fast_range(x, n);
+  }
+
+  static uint64_t hash_word(std::string_view word)
+  {
+    return hasher::WyHash::hash(std::as_bytes(std::span{word.data(), word.size()}));
+  }
+
+  // Return a bit mask with bit i set if ctrl[i] == tag.
+  static unsigned int match_tag(int8_t const* ctrl, int8_t tag)
+  {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128(reinterpret_cast<__m128i const*>(ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), group));
+#else
+    unsigned int mask = 0;
+    for (size_t i = 0; i < group_size; ++i)
+      mask |= static_cast<unsigned int>(ctrl[i] == tag) << i;
+    return mask;
+#endif
+  }
+
+  // Return a bit mask with bit i set if ctrl[i] == ctrl_empty.
+  static unsigned int match_empty(int8_t const* ctrl)
+  {
+#if defined(__SSE2__)
+    // Only ctrl_empty has its high bit set.
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(ctrl)));
+#else
+    unsigned int mask = 0;
+    for (size_t i = 0; i < group_size; ++i)
+      mask |= static_cast<unsigned int>(ctrl[i] == ctrl_empty) << i;
+    return mask;
+#endif
+  }
 
  private:
+  void insert_into_table(uint64_t hash, uint32_t index);
+  void grow_table();
+
   // This does nothing, unless this is a DictionaryData class.
   virtual void add_new_data(size_t index, std::string word) { }
 };
@@ -80,7 +207,8 @@ class DictionaryBase
 //
 // If the dictionary can be used by multiple threads, for example because it is
 // a static member of a template class, then it should be wrapped by aithreadsafe
-// using a read/write lock:
+// using a read/write lock (or use utils::ConcurrentDictionary, see ConcurrentDictionary.h,
+// which doesn't need a lock for lookups):
 //
 // template<typename T>
 // struct Example {
@@ -128,15 +256,15 @@ class Dictionary : public DictionaryBase
   void add(ENUM_TYPE index, std::string word)
   {
     // index must be sequential, starting with 0 and 1 larger every call.
-    ASSERT(m_unique_words.size() == static_cast<size_t>(index));
-    this->add_new_unique_word(std::move(word));
+    ASSERT(this->size() == static_cast<size_t>(index));
+    this->add_new_unique_word(word);
   }
 
   void add(ENUM_TYPE index, std::string_view&& word)
   {
     // index must be sequential, starting with 0 and 1 larger every call.
-    ASSERT(m_unique_words.size() == static_cast<size_t>(index));
-    this->add_new_unique_word(std::string{word});
+    ASSERT(this->size() == static_cast<size_t>(index));
+    this->add_new_unique_word(word);
   }
 
   // Return a unique index for each unique word.
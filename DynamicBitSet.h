@@ -0,0 +1,467 @@
+#pragma once
+
+#include "ctz.h"
+#include "clz.h"
+#include "popcount.h"
+#include "debug.h"
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <compare>
+#include <string>
+#include <iostream>
+
+namespace utils {
+
+// Forward declaration.
+class DynamicBitSet;
+
+namespace dynamic_bitset {
+
+// POD struct for Index.
+//
+// Like bitset::IndexPOD, but for a DynamicBitSet with N bits, where N is only known at runtime.
+//
+// If the value is in the range [0, N>, then it represents the bit index,
+// where 0 refers to the least significant bit of the first word.
+//
+// The value -1 means "one before begin()" and N means "one past the end",
+// see DynamicBitSet::iend().
+//
+struct IndexPOD
+{
+  int64_t m_index;
+};
+
+// Define a few handy constants.
+//
+constexpr IndexPOD index_pre_begin = { -1 };
+constexpr IndexPOD index_begin = { 0 };
+
+class Index : protected IndexPOD
+{
+ public:
+  // Constructors.
+
+  // Construct an uninitialized Index.
+  constexpr Index() { }
+  // Copy-constructor.
+  constexpr Index(Index const& i1) { m_index = i1.m_index; }
+  // Construct a Index from a constant.
+  constexpr Index(IndexPOD i1) { m_index = i1.m_index; }
+
+  // Assignment operators.
+
+  // Assign from another Index.
+  Index& operator=(Index i1) { m_index = i1.m_index; return *this; }
+  // Assign from a constant.
+  Index& operator=(IndexPOD i1) { m_index = i1.m_index; return *this; }
+
+  // Comparision operators.
+
+  friend std::strong_ordering operator<=>(Index const& i1, Index const& i2) { return i1.m_index <=> i2.m_index; }
+  friend std::strong_ordering operator<=>(Index const& i1, IndexPOD const& i2) { return i1.m_index <=> i2.m_index; }
+  friend std::strong_ordering operator<=>(IndexPOD const& i1, Index const& i2) { return i1.m_index <=> i2.m_index; }
+
+  friend constexpr bool operator==(Index const& i1, Index const& i2) { return i1.m_index == i2.m_index; }
+  friend constexpr bool operator==(Index const& i1, IndexPOD i2) { return i1.m_index == i2.m_index; }
+  friend constexpr bool operator==(IndexPOD i1, Index const& i2) { return i1.m_index == i2.m_index; }
+
+  // Manipulators.
+
+  constexpr Index& operator+=(int64_t offset) { m_index += offset; return *this; }
+  friend constexpr Index operator+(Index index, int64_t offset) { Index result(index); return result += offset; }
+  constexpr Index& operator-=(int64_t offset) { m_index -= offset; return *this; }
+  friend constexpr Index operator-(Index index, int64_t offset) { Index result(index); return result -= offset; }
+  friend constexpr int64_t operator-(Index index1, Index index2) { return index1.m_index - index2.m_index; }
+
+  Index& operator++() { ++m_index; return *this; }
+  Index operator++(int) { Index result(*this); operator++(); return result; }
+  Index& operator--() { --m_index; return *this; }
+  Index operator--(int) { Index result(*this); operator--(); return result; }
+
+  // Accessor.
+
+  // Return the unlaying integral value.
+  constexpr int64_t operator()() const { return m_index; }
+
+  // Special functions.
+
+  // Advance Index to the next bit that is set in m1.
+  //
+  // Index may be index_pre_begin, in which case it will be set
+  // to the first bit that is set in m1 if any, or m1.iend()
+  // if no bit is set.
+  //
+  // Otherwise Index must be in the range [0, N>, in which
+  // case a value is returned larger than the current value.
+  // If no more bits could be found, Index is set to m1.iend().
+  //
+  // Don't call this function when Index equals m1.iend().
+  inline void next_bit_in(DynamicBitSet const& m1);
+
+  // Decrease Index to the previous bit that is set in m1.
+  //
+  // Index may be m1.iend(), in which case it will be set to the
+  // last bit that is set in m1 if any, or index_pre_begin if no
+  // bit is set.
+  //
+  // Otherwise Index must be in the range [0, N>, in which
+  // case a value is returned smaller than the current value.
+  // If no more bits could be found (which is always the case
+  // if Index equals index_begin or m1 is empty), Index is set
+  // to index_pre_begin.
+  inline void prev_bit_in(DynamicBitSet const& m1);
+
+  // Return true iff Index is not index_pre_begin and also not index_begin.
+  bool may_call_prev_bit_in() const { return m_index > 0; }
+
+  // Writing to an ostream.
+
+  friend std::ostream& operator<<(std::ostream& os, Index const& i1)
+  {
+    return os << i1.m_index;
+  }
+};
+
+class const_iterator
+{
+  DynamicBitSet const* m_bitset;
+  Index m_index;        // The current set bit, or m_bitset->iend().
+
+ public:
+  // Construct a const_iterator pointing to the first set bit at or after index.
+  inline const_iterator(DynamicBitSet const* bitset, Index index);
+
+  // Comparision operators.
+
+  bool operator==(const_iterator const& iter) const { return m_index == iter.m_index; }
+  bool operator!=(const_iterator const& iter) const { return !(m_index == iter.m_index); }
+
+  // Forward iterator.
+
+  const_iterator& operator++() { m_index.next_bit_in(*m_bitset); return *this; }
+
+  Index operator*() const { return m_index; }
+};
+
+} // namespace dynamic_bitset
+
+// A bitset with a number of bits that is only known at runtime (thousands to millions of bits).
+//
+// The interface follows that of BitSet<T> where possible, but bits are addressed with a
+// dynamic_bitset::Index (a 64-bit index) and iterating over a DynamicBitSet returns
+// the Index of each set bit (rather than a single bit mask).
+//
+// The bits are stored in an array of 64-bit words. The set operations are simple loops
+// over the words without data dependent branches, which the compiler vectorizes (use
+// -O3 or -ftree-vectorize, and -mavx2 or -march=native to get the widest registers).
+// Unused bits in the last word are always zero.
+//
+// Example:
+//
+//   utils::DynamicBitSet visible(number_of_nodes);
+//   visible.set(utils::dynamic_bitset::IndexPOD{42});
+//   visible &= reachable;
+//   for (utils::dynamic_bitset::Index node : visible)
+//     ...
+//
+class DynamicBitSet
+{
+ public:
+  using word_type = uint64_t;
+  using Index = dynamic_bitset::Index;
+  static constexpr size_t bits_per_word = 8 * sizeof(word_type);
+
+ private:
+  std::vector<word_type> m_words;
+  size_t m_size;                        // The number of bits.
+
+  static size_t word_index(Index i1) { return static_cast<size_t>(i1()) / bits_per_word; }
+  static word_type index2mask(Index i1) { return word_type{1} << (static_cast<size_t>(i1()) % bits_per_word); }
+
+  // Clear the unused bits in the last word.
+  void clear_unused_bits()
+  {
+    if (size_t used = m_size % bits_per_word)
+      m_words.back() &= (word_type{1} << used) - 1;
+  }
+
+ public:
+  // Constructors.
+
+  // Construct an empty DynamicBitSet.
+  DynamicBitSet() : m_size(0) { }
+
+  // Construct a DynamicBitSet of number_of_bits bits, all zero.
+  explicit DynamicBitSet(size_t number_of_bits) : m_words((number_of_bits + bits_per_word - 1) / bits_per_word, 0), m_size(number_of_bits) { }
+
+  // Change the number of bits. New bits are zero.
+  void resize(size_t number_of_bits)
+  {
+    m_words.resize((number_of_bits + bits_per_word - 1) / bits_per_word, 0);
+    m_size = number_of_bits;
+    if (!m_words.empty())
+      clear_unused_bits();
+  }
+
+  // Comparison operators.
+
+  friend bool operator==(DynamicBitSet const& m1, DynamicBitSet const& m2) { return m1.m_size == m2.m_size && m1.m_words == m2.m_words; }
+  friend bool operator!=(DynamicBitSet const& m1, DynamicBitSet const& m2) { return !(m1 == m2); }
+
+  // Initialization.
+
+  // Set all bits to zero.
+  void reset() { std::fill(m_words.begin(), m_words.end(), 0); }
+
+  // Set all bits to one.
+  void set()
+  {
+    std::fill(m_words.begin(), m_words.end(), ~word_type{0});
+    if (!m_words.empty())
+      clear_unused_bits();
+  }
+
+  // Bit manipulation.
+
+  // Reset the bit at index i1.
+  void reset(Index const& i1) { m_words[word_index(i1)] &= ~index2mask(i1); }
+
+  // Reset the bits from m1 (and-not).
+  void reset(DynamicBitSet const& m1)
+  {
+    ASSERT(m_size == m1.m_size);
+    // The loop below requires that w and w1 don't alias.
+    if (&m1 == this)
+    {
+      reset();
+      return;
+    }
+    word_type* __restrict__ w = m_words.data();
+    word_type const* __restrict__ w1 = m1.m_words.data();
+    for (size_t i = 0, n = m_words.size(); i < n; ++i)
+      w[i] &= ~w1[i];
+  }
+
+  // Set the bit at i1.
+  void set(Index const& i1) { m_words[word_index(i1)] |= index2mask(i1); }
+
+  // Set the bits from m1.
+  void set(DynamicBitSet const& m1) { operator|=(m1); }
+
+  // Toggle the bit at i1.
+  void flip(Index const& i1) { m_words[word_index(i1)] ^= index2mask(i1); }
+
+  // Toggle the bits from m1.
+  void flip(DynamicBitSet const& m1) { operator^=(m1); }
+
+  // Accessors.
+
+  // Test if all, any or none of the bits are set.
+  bool all() const { return count() == m_size; }
+  bool any() const
+  {
+    word_type accumulator = 0;
+    for (word_type w : m_words)
+      accumulator |= w;
+    return accumulator;
+  }
+  bool none() const { return !any(); }
+
+  // Returns the number of bits that the bitset can hold.
+  size_t size() const { return m_size; }
+
+  // Returns the number of bits set to 1.
+  size_t count() const
+  {
+    size_t result = 0;
+    for (word_type w : m_words)
+      result += utils::popcount(w);
+    return result;
+  }
+
+  // Return the index to the least significant set bit.
+  // Returns iend() if the DynamicBitSet is zero.
+  Index lssbi() const { Index result(dynamic_bitset::index_pre_begin); result.next_bit_in(*this); return result; }
+
+  // Return the index to the most significant set bit.
+  // Returns index_pre_begin if the DynamicBitSet is zero.
+  Index mssbi() const { Index result(iend()); result.prev_bit_in(*this); return result; }
+
+  // Test if any bit is set at all.
+  bool test() const { return any(); }
+
+  // Test if the bit at i1 is set.
+  bool test(Index const& i1) const { return m_words[word_index(i1)] & index2mask(i1); }
+
+  // Test if any bit in m1 is set.
+  bool test(DynamicBitSet const& m1) const
+  {
+    ASSERT(m_size == m1.m_size);
+    word_type accumulator = 0;
+    for (size_t i = 0, n = m_words.size(); i < n; ++i)
+      accumulator |= m_words[i] & m1.m_words[i];
+    return accumulator;
+  }
+
+  // Return the index one past the last bit.
+  Index iend() const { return dynamic_bitset::IndexPOD{static_cast<int64_t>(m_size)}; }
+
+  // Return the underlaying words.
+  word_type const* data() const { return m_words.data(); }
+  size_t number_of_words() const { return m_words.size(); }
+
+  // Return the inverse of the DynamicBitSet.
+  DynamicBitSet operator~() const
+  {
+    DynamicBitSet result(*this);
+    for (word_type& w : result.m_words)
+      w = ~w;
+    if (!result.m_words.empty())
+      result.clear_unused_bits();
+    return result;
+  }
+
+  // Converts the contents of the bitset to a string (most significant bit first).
+  std::string to_string(char zero = '0', char one = '1') const
+  {
+    std::string result(m_size, zero);
+    for (size_t i = 0; i < m_size; ++i)
+      if (test(dynamic_bitset::IndexPOD{static_cast<int64_t>(i)}))
+        result[m_size - 1 - i] = one;
+    return result;
+  }
+
+  // Bit-wise OR operators with another DynamicBitSet.
+  DynamicBitSet& operator|=(DynamicBitSet const& m1)
+  {
+    ASSERT(m_size == m1.m_size);
+    if (&m1 == this)
+      return *this;
+    word_type* __restrict__ w = m_words.data();
+    word_type const* __restrict__ w1 = m1.m_words.data();
+    for (size_t i = 0, n = m_words.size(); i < n; ++i)
+      w[i] |= w1[i];
+    return *this;
+  }
+  friend DynamicBitSet operator|(DynamicBitSet m1, DynamicBitSet const& m2) { return m1 |= m2; }
+
+  // Bit-wise AND operators with another DynamicBitSet.
+  DynamicBitSet& operator&=(DynamicBitSet const& m1)
+  {
+    ASSERT(m_size == m1.m_size);
+    if (&m1 == this)
+      return *this;
+    word_type* __restrict__ w = m_words.data();
+    word_type const* __restrict__ w1 = m1.m_words.data();
+    for (size_t i = 0, n = m_words.size(); i < n; ++i)
+      w[i] &= w1[i];
+    return *this;
+  }
+  friend DynamicBitSet operator&(DynamicBitSet m1, DynamicBitSet const& m2) { return m1 &= m2; }
+
+  // Bit-wise XOR operators with another DynamicBitSet.
+  DynamicBitSet& operator^=(DynamicBitSet const& m1)
+  {
+    ASSERT(m_size == m1.m_size);
+    if (&m1 == this)
+    {
+      reset();
+      return *this;
+    }
+    word_type* __restrict__ w = m_words.data();
+    word_type const* __restrict__ w1 = m1.m_words.data();
+    for (size_t i = 0, n = m_words.size(); i < n; ++i)
+      w[i] ^= w1[i];
+    return *this;
+  }
+  friend DynamicBitSet operator^(DynamicBitSet m1, DynamicBitSet const& m2) { return m1 ^= m2; }
+
+  // Writing to an ostream.
+
+  friend std::ostream& operator<<(std::ostream& os, DynamicBitSet const& m1)
+  {
+    return os << m1.to_string();
+  }
+
+  // Iterator support.
+
+  dynamic_bitset::const_iterator begin() const { return {this, dynamic_bitset::index_pre_begin}; }
+  dynamic_bitset::const_iterator end() const { return {this, iend()}; }
+
+  friend class dynamic_bitset::Index;
+};
+
+namespace dynamic_bitset {
+
+// Inline functions.
+
+void Index::next_bit_in(DynamicBitSet const& m1)
+{
+  using word_type = DynamicBitSet::word_type;
+  constexpr size_t bits_per_word = DynamicBitSet::bits_per_word;
+  size_t const number_of_words = m1.m_words.size();
+  size_t const next = m_index + 1;
+  size_t wi = next / bits_per_word;
+  if (wi < number_of_words)
+  {
+    // Look in the remainder of the current word.
+    word_type w = m1.m_words[wi] >> (next % bits_per_word);
+    if (w)
+    {
+      m_index = next + ctz(w);
+      return;
+    }
+    // Skip zero words.
+    while (++wi < number_of_words)
+    {
+      if ((w = m1.m_words[wi]))
+      {
+        m_index = wi * bits_per_word + ctz(w);
+        return;
+      }
+    }
+  }
+  m_index = m1.m_size;
+}
+
+void Index::prev_bit_in(DynamicBitSet const& m1)
+{
+  using word_type = DynamicBitSet::word_type;
+  constexpr size_t bits_per_word = DynamicBitSet::bits_per_word;
+  if (m_index == 0 || m1.m_words.empty())
+  {
+    m_index = index_pre_begin.m_index;
+    return;
+  }
+  // The general case, assume bits_per_word == 8, the word is 01100010 and index 5.
+  size_t prev = m_index - 1;                                    // prev becomes 4.
+  size_t wi = prev / bits_per_word;
+  // Remove the bits above prev.
+  word_type w = m1.m_words[wi] << (bits_per_word - 1 - prev % bits_per_word);   // w becomes 00010000 (shifted by 3).
+  if (w)
+  {
+    m_index = prev - clz(w);                                    // m_index becomes 1.
+    return;
+  }
+  while (wi-- > 0)
+  {
+    if ((w = m1.m_words[wi]))
+    {
+      m_index = wi * bits_per_word + bits_per_word - 1 - clz(w);
+      return;
+    }
+  }
+  m_index = index_pre_begin.m_index;
+}
+
+const_iterator::const_iterator(DynamicBitSet const* bitset, Index index) : m_bitset(bitset), m_index(index)
+{
+  if (m_index == index_pre_begin)
+    m_index.next_bit_in(*m_bitset);
+}
+
+} // namespace dynamic_bitset
+
+} // namespace utils
@@ -0,0 +1,109 @@
+// Benchmark of DynamicBitSet versus std::bitset and boost::dynamic_bitset.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. DynamicBitSet_bench.cxx
+//
+// and compare with -O3 and/or -march=native. It measures, per 64-bit word, the set
+// operations |=, &=, ^=, and-not and count, and, per set bit, iterating over the set bits.
+
+#include "sys.h"
+#include "utils/DynamicBitSet.h"
+#include <boost/dynamic_bitset.hpp>
+#include <bitset>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+size_t volatile s_sink;
+
+template<size_t number_of_bits>
+void benchmark(double density)
+{
+  constexpr size_t number_of_words = number_of_bits / 64;
+  constexpr int rounds = (1 << 26) / number_of_bits;
+
+  std::mt19937_64 generator(number_of_bits);
+  std::bernoulli_distribution bit(density);
+  auto a_std = std::make_unique<std::bitset<number_of_bits>>();
+  auto b_std = std::make_unique<std::bitset<number_of_bits>>();
+  boost::dynamic_bitset<uint64_t> a_boost(number_of_bits), b_boost(number_of_bits);
+  utils::DynamicBitSet a_utils(number_of_bits), b_utils(number_of_bits);
+  size_t number_of_set_bits = 0;
+  for (size_t i = 0; i < number_of_bits; ++i)
+  {
+    if (bit(generator))
+    {
+      a_std->set(i);
+      a_boost.set(i);
+      a_utils.set(utils::dynamic_bitset::IndexPOD{static_cast<int64_t>(i)});
+      ++number_of_set_bits;
+    }
+    if (bit(generator))
+    {
+      b_std->set(i);
+      b_boost.set(i);
+      b_utils.set(utils::dynamic_bitset::IndexPOD{static_cast<int64_t>(i)});
+    }
+  }
+
+  std::cout << number_of_bits << " bits, density " << density << ":\n";
+  auto report = [](char const* operation, double std_ns, double boost_ns, double utils_ns, char const* unit){
+    std::cout << "  " << std::left << std::setw(10) << operation << std::fixed << std::setprecision(3) <<
+      "std::bitset " << std::setw(8) << std_ns << "boost::dynamic_bitset " << std::setw(8) << boost_ns <<
+      "DynamicBitSet " << std::setw(8) << utils_ns << unit << '\n';
+  };
+  auto time = [](auto&& operation, double count){
+    auto start = clock_type::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+      operation();
+      asm volatile ("" ::: "memory");
+    }
+    return std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / (rounds * count);
+  };
+
+  // Alternate the operations so that the contents of a stay random.
+  report("|= &=",
+      time([&]{ *a_std |= *b_std; *a_std &= *b_std; }, 2 * number_of_words),
+      time([&]{ a_boost |= b_boost; a_boost &= b_boost; }, 2 * number_of_words),
+      time([&]{ a_utils |= b_utils; a_utils &= b_utils; }, 2 * number_of_words), " ns/word");
+  report("^=",
+      time([&]{ *a_std ^= *b_std; }, number_of_words),
+      time([&]{ a_boost ^= b_boost; }, number_of_words),
+      time([&]{ a_utils ^= b_utils; }, number_of_words), " ns/word");
+  report("and-not",
+      time([&]{ *a_std &= ~*b_std; }, number_of_words),
+      time([&]{ a_boost -= b_boost; }, number_of_words),
+      time([&]{ a_utils.reset(b_utils); }, number_of_words), " ns/word");
+  report("count",
+      time([&]{ s_sink = a_std->count(); }, number_of_words),
+      time([&]{ s_sink = a_boost.count(); }, number_of_words),
+      time([&]{ s_sink = a_utils.count(); }, number_of_words), " ns/word");
+
+  // Restore a.
+  *a_std |= *b_std;
+  a_boost |= b_boost;
+  a_utils |= b_utils;
+  number_of_set_bits = a_utils.count();
+  report("iterate",
+      time([&]{ size_t sum = 0; for (size_t i = a_std->_Find_first(); i < number_of_bits; i = a_std->_Find_next(i)) sum += i; s_sink = sum; }, number_of_set_bits),
+      time([&]{ size_t sum = 0; for (size_t i = a_boost.find_first(); i != a_boost.npos; i = a_boost.find_next(i)) sum += i; s_sink = sum; }, number_of_set_bits),
+      time([&]{ size_t sum = 0; for (auto i : a_utils) sum += i(); s_sink = sum; }, number_of_set_bits), " ns/set bit");
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  benchmark<4096>(0.5);
+  benchmark<1048576>(0.5);
+  benchmark<1048576>(0.01);
+}
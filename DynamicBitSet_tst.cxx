@@ -0,0 +1,133 @@
+// Test of DynamicBitSet against a std::set of the indices of the set bits.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -D_GLIBCXX_ASSERTIONS -I. DynamicBitSet_tst.cxx
+//
+// and run it; it prints "Success!" or aborts with an error message.
+
+#include "sys.h"
+#include "utils/DynamicBitSet.h"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+using utils::DynamicBitSet;
+using utils::dynamic_bitset::IndexPOD;
+using utils::dynamic_bitset::index_pre_begin;
+
+void check(bool condition, char const* what)
+{
+  if (!condition)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    std::abort();
+  }
+}
+
+// Return a DynamicBitSet of size bits, and the indices of its set bits in reference.
+DynamicBitSet random_bitset(std::mt19937& generator, size_t size, std::set<int64_t>& reference)
+{
+  DynamicBitSet result(size);
+  reference.clear();
+  for (int k = 0, n = generator() % 50; k < n; ++k)
+  {
+    int64_t i = generator() % size;
+    result.set(IndexPOD{i});
+    reference.insert(i);
+  }
+  return result;
+}
+
+void check_equal(DynamicBitSet const& bitset, std::set<int64_t> const& reference, char const* what)
+{
+  std::vector<int64_t> forward;
+  for (auto index : bitset)
+    forward.push_back(index());
+  check(forward == std::vector<int64_t>(reference.begin(), reference.end()), what);
+  check(bitset.count() == reference.size(), what);
+  check(bitset.lssbi()() == (reference.empty() ? static_cast<int64_t>(bitset.size()) : *reference.begin()), what);
+  check(bitset.mssbi()() == (reference.empty() ? index_pre_begin.m_index : *reference.rbegin()), what);
+  // Iterate backwards.
+  std::vector<int64_t> backward;
+  for (DynamicBitSet::Index index = bitset.iend();;)
+  {
+    index.prev_bit_in(bitset);
+    if (index == index_pre_begin)
+      break;
+    backward.push_back(index());
+  }
+  check(backward == std::vector<int64_t>(reference.rbegin(), reference.rend()), what);
+}
+
+void test_empty()
+{
+  DynamicBitSet empty;
+  check(empty.lssbi() == empty.iend(), "lssbi of an empty set");
+  check(empty.mssbi() == index_pre_begin, "mssbi of an empty set");
+  check(empty.none() && empty.count() == 0, "count of an empty set");
+  DynamicBitSet::Index begin(utils::dynamic_bitset::index_begin);
+  DynamicBitSet one_bit(1);
+  one_bit.set(IndexPOD{0});
+  begin.prev_bit_in(one_bit);
+  check(begin == index_pre_begin, "prev_bit_in from index_begin");
+}
+
+void test_random()
+{
+  std::mt19937 generator(5);
+  for (int round = 0; round < 1000; ++round)
+  {
+    size_t size = generator() % 700 + 1;
+    std::set<int64_t> r1, r2;
+    DynamicBitSet b1 = random_bitset(generator, size, r1);
+    DynamicBitSet b2 = random_bitset(generator, size, r2);
+    check_equal(b1, r1, "set");
+
+    std::set<int64_t> expected;
+    std::set_union(r1.begin(), r1.end(), r2.begin(), r2.end(), std::inserter(expected, expected.end()));
+    check_equal(b1 | b2, expected, "operator|");
+    expected.clear();
+    std::set_intersection(r1.begin(), r1.end(), r2.begin(), r2.end(), std::inserter(expected, expected.end()));
+    check_equal(b1 & b2, expected, "operator&");
+    check(b1.test(b2) == !expected.empty(), "test(DynamicBitSet)");
+    expected.clear();
+    std::set_symmetric_difference(r1.begin(), r1.end(), r2.begin(), r2.end(), std::inserter(expected, expected.end()));
+    check_equal(b1 ^ b2, expected, "operator^");
+    expected.clear();
+    std::set_difference(r1.begin(), r1.end(), r2.begin(), r2.end(), std::inserter(expected, expected.end()));
+    DynamicBitSet difference(b1);
+    difference.reset(b2);
+    check_equal(difference, expected, "reset(DynamicBitSet)");
+    check((~b1).count() == size - r1.size(), "operator~");
+
+    // Operations with itself.
+    DynamicBitSet b(b1);
+    b |= b;
+    check_equal(b, r1, "b |= b");
+    b &= b;
+    check_equal(b, r1, "b &= b");
+    b ^= b;
+    check_equal(b, {}, "b ^= b");
+    b = b1;
+    b.reset(b);
+    check_equal(b, {}, "b.reset(b)");
+  }
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  test_empty();
+  test_random();
+
+  std::cout << "Success!" << std::endl;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "FlatSet.h"
+#include <stdexcept>
+
+// A map stored as a sorted std::vector<std::pair<Key, T>>; see FlatSet.h.
+//
+// Usage:
+//
+//   utils::FlatMap<std::string, int> map;
+//   map.insert_range(pairs.begin(), pairs.end());
+//   map["answer"] = 42;
+//   if (auto iter = map.find("question"); iter != map.end())
+//     iter->second += 1;                                       // Never change iter->first!
+//
+namespace utils {
+namespace detail {
+
+struct FlatMapKeyOf
+{
+  template<typename K, typename T>
+  K const& operator()(std::pair<K, T> const& value) const { return value.first; }
+};
+
+} // namespace detail
+
+template<typename Key, typename T, typename Compare = std::less<Key>, bool unique = true>
+class FlatMap : public detail::FlatSortedVector<std::pair<Key, T>, Key, detail::FlatMapKeyOf, Compare, unique>
+{
+  using base_type = detail::FlatSortedVector<std::pair<Key, T>, Key, detail::FlatMapKeyOf, Compare, unique>;
+
+ public:
+  using mapped_type = T;
+  using iterator = typename base_type::container_type::iterator;
+  using typename base_type::const_iterator;
+
+  using base_type::FlatSortedVector;
+  using base_type::begin;
+  using base_type::end;
+  using base_type::find;
+
+  // Mutable iterators allow changing the mapped values, but the keys must not be changed.
+  iterator begin() { return this->m_values.begin(); }
+  iterator end() { return this->m_values.end(); }
+
+  iterator find(Key const& key)
+  {
+    return this->m_values.begin() + (static_cast<base_type const*>(this)->find(key) - this->m_values.cbegin());
+  }
+
+  // Return the mapped value of key, inserting a value-initialized one if it doesn't exist yet; O(n) if inserted.
+  T& operator[](Key const& key) requires unique
+  {
+    size_t index = this->lower_bound_index(key);
+    if (index == this->m_values.size() || this->m_compare(key, this->m_values[index].first))
+      this->m_values.emplace(this->m_values.begin() + index, key, T{});
+    return this->m_values[index].second;
+  }
+
+  T& at(Key const& key)
+  {
+    iterator iter = find(key);
+    if (iter == end())
+      throw std::out_of_range("utils::FlatMap::at");
+    return iter->second;
+  }
+
+  T const& at(Key const& key) const
+  {
+    const_iterator iter = find(key);
+    if (iter == end())
+      throw std::out_of_range("utils::FlatMap::at");
+    return iter->second;
+  }
+};
+
+template<typename Key, typename T, typename Compare = std::less<Key>>
+using FlatMultiMap = FlatMap<Key, T, Compare, false>;
+
+} // namespace utils
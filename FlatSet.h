@@ -0,0 +1,232 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+// A set (and, see FlatMap.h, a map) stored as a sorted std::vector.
+//
+// Compared to std::set this uses much less memory, has no allocation per element and
+// iterates over contiguous memory. The price is O(n) single-element insertion and erasure,
+// therefore build it with the constructor that takes a range, or insert_range, which append
+// the new elements, sort them and then merge them with the existing elements: O(n + m log m).
+//
+// Usage:
+//
+//   utils::FlatSet<int> set(keys.begin(), keys.end());         // Sorted, without duplicates.
+//   set.insert_range(more_keys.begin(), more_keys.end());
+//   if (set.contains(42))
+//     ...
+//
+// If `unique` is false duplicates are kept (like std::multiset).
+// When unique is true and an equivalent element is inserted, then the element that was
+// already there (or, within one call to insert_range, the first one) is kept.
+//
+namespace utils {
+namespace detail {
+
+template<typename Value, typename Key, typename KeyOf, typename Compare, bool unique>
+class FlatSortedVector
+{
+ public:
+  using key_type = Key;
+  using value_type = Value;
+  using key_compare = Compare;
+  using size_type = size_t;
+  using container_type = std::vector<Value>;
+  using const_iterator = typename container_type::const_iterator;
+
+ protected:
+  container_type m_values;
+  [[no_unique_address]] Compare m_compare;
+
+  static Key const& key_of(Value const& value) { return KeyOf{}(value); }
+
+  // The index of the first element that is not less than key.
+  //
+  // This is a branchless binary search: the compiler turns the conditional into a
+  // conditional move, so that there are no branch mispredictions. For large sizes the
+  // two possible next probes are prefetched.
+  size_t lower_bound_index(Key const& key) const
+  {
+    Value const* const data = m_values.data();
+    Value const* base = data;
+    size_t n = m_values.size();
+    if (n == 0)
+      return 0;
+    while (n > 1)
+    {
+      size_t const half = n / 2;
+#if defined(__GNUC__)
+      __builtin_prefetch(base + half / 2);
+      __builtin_prefetch(base + half + half / 2);
+#endif
+      base = m_compare(key_of(base[half]), key) ? base + half : base;
+      n -= half;
+    }
+    return (base - data) + m_compare(key_of(*base), key);
+  }
+
+  // The index of the first element that is greater than key.
+  size_t upper_bound_index(Key const& key) const
+  {
+    Value const* const data = m_values.data();
+    Value const* base = data;
+    size_t n = m_values.size();
+    if (n == 0)
+      return 0;
+    while (n > 1)
+    {
+      size_t const half = n / 2;
+#if defined(__GNUC__)
+      __builtin_prefetch(base + half / 2);
+      __builtin_prefetch(base + half + half / 2);
+#endif
+      base = !m_compare(key, key_of(base[half])) ? base + half : base;
+      n -= half;
+    }
+    return (base - data) + !m_compare(key, key_of(*base));
+  }
+
+  bool equivalent(Key const& key1, Key const& key2) const
+  {
+    return !m_compare(key1, key2) && !m_compare(key2, key1);
+  }
+
+  // Sort the elements from index `first` onwards and merge them with the (sorted) elements before it.
+  void merge_tail(size_t first)
+  {
+    auto compare_values = [this](Value const& v1, Value const& v2){ return m_compare(key_of(v1), key_of(v2)); };
+    auto middle = m_values.begin() + first;
+    // Use a stable sort, so that the first of equivalent new elements comes first.
+    std::stable_sort(middle, m_values.end(), compare_values);
+    // Only duplicates at the seam and in the tail can exist, unless the two ranges are interleaved.
+    size_t dedup_begin = first > 0 ? first - 1 : 0;
+    // Skip the merge in the common case of appending larger elements.
+    if (middle != m_values.begin() && middle != m_values.end() && compare_values(*middle, middle[-1]))
+    {
+      // This merge is stable: existing elements come before equivalent new ones.
+      std::inplace_merge(m_values.begin(), middle, m_values.end(), compare_values);
+      dedup_begin = 0;
+    }
+    if constexpr (unique)
+      m_values.erase(std::unique(m_values.begin() + dedup_begin, m_values.end(),
+            [this](Value const& v1, Value const& v2){ return equivalent(key_of(v1), key_of(v2)); }), m_values.end());
+  }
+
+ public:
+  FlatSortedVector() = default;
+  explicit FlatSortedVector(Compare const& compare) : m_compare(compare) { }
+
+  template<typename InputIt>
+  FlatSortedVector(InputIt first, InputIt last, Compare const& compare = Compare()) : m_compare(compare)
+  {
+    insert_range(first, last);
+  }
+
+  FlatSortedVector(std::initializer_list<Value> ilist, Compare const& compare = Compare()) : m_compare(compare)
+  {
+    insert_range(ilist.begin(), ilist.end());
+  }
+
+  // Iterators are read-only: changing the key of an element would break the order.
+  const_iterator begin() const { return m_values.begin(); }
+  const_iterator end() const { return m_values.end(); }
+  const_iterator cbegin() const { return m_values.cbegin(); }
+  const_iterator cend() const { return m_values.cend(); }
+
+  size_t size() const { return m_values.size(); }
+  bool empty() const { return m_values.empty(); }
+  size_t capacity() const { return m_values.capacity(); }
+  void reserve(size_t capacity) { m_values.reserve(capacity); }
+  void clear() { m_values.clear(); }
+  void shrink_to_fit() { m_values.shrink_to_fit(); }
+
+  // Access to the underlying (sorted) vector.
+  container_type const& values() const { return m_values; }
+
+  // Insert a single element; O(n). Returns the position of the element and whether it was inserted.
+  std::pair<const_iterator, bool> insert(Value const& value)
+  {
+    if constexpr (unique)
+    {
+      size_t index = lower_bound_index(key_of(value));
+      if (index != m_values.size() && !m_compare(key_of(value), key_of(m_values[index])))
+        return { m_values.begin() + index, false };
+      return { m_values.insert(m_values.begin() + index, value), true };
+    }
+    else
+      return { m_values.insert(m_values.begin() + upper_bound_index(key_of(value)), value), true };
+  }
+
+  // Insert many elements at once: O(n + m log m), where m = std::distance(first, last).
+  template<typename InputIt>
+  void insert_range(InputIt first, InputIt last)
+  {
+    size_t const old_size = m_values.size();
+    m_values.insert(m_values.end(), first, last);
+    merge_tail(old_size);
+  }
+
+  size_t erase(Key const& key)
+  {
+    auto range = equal_range(key);
+    size_t count = range.second - range.first;
+    m_values.erase(range.first, range.second);
+    return count;
+  }
+
+  const_iterator erase(const_iterator pos) { return m_values.erase(pos); }
+  const_iterator erase(const_iterator first, const_iterator last) { return m_values.erase(first, last); }
+
+  const_iterator lower_bound(Key const& key) const { return m_values.begin() + lower_bound_index(key); }
+  const_iterator upper_bound(Key const& key) const { return m_values.begin() + upper_bound_index(key); }
+
+  std::pair<const_iterator, const_iterator> equal_range(Key const& key) const
+  {
+    const_iterator first = lower_bound(key);
+    if constexpr (unique)
+      return { first, first + (first != end() && !m_compare(key, key_of(*first))) };
+    else
+      return { first, upper_bound(key) };
+  }
+
+  const_iterator find(Key const& key) const
+  {
+    const_iterator iter = lower_bound(key);
+    if (iter != end() && !m_compare(key, key_of(*iter)))
+      return iter;
+    return end();
+  }
+
+  bool contains(Key const& key) const { return find(key) != end(); }
+
+  size_t count(Key const& key) const
+  {
+    auto range = equal_range(key);
+    return range.second - range.first;
+  }
+
+  friend bool operator==(FlatSortedVector const& lhs, FlatSortedVector const& rhs) { return lhs.m_values == rhs.m_values; }
+};
+
+struct FlatSetKeyOf
+{
+  template<typename T>
+  T const& operator()(T const& value) const { return value; }
+};
+
+} // namespace detail
+
+template<typename Key, typename Compare = std::less<Key>, bool unique = true>
+class FlatSet : public detail::FlatSortedVector<Key, Key, detail::FlatSetKeyOf, Compare, unique>
+{
+  using detail::FlatSortedVector<Key, Key, detail::FlatSetKeyOf, Compare, unique>::FlatSortedVector;
+};
+
+template<typename Key, typename Compare = std::less<Key>>
+using FlatMultiSet = FlatSet<Key, Compare, false>;
+
+} // namespace utils
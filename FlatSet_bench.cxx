@@ -0,0 +1,93 @@
+// Benchmark of FlatSet versus std::set and a std::vector kept sorted with sorted_vector_insert.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. FlatSet_bench.cxx
+//
+// For N random ints it measures building the set from all keys (for the vector, by repeatedly
+// inserting a single key) and one million lookups, half of which miss.
+
+#include "sys.h"
+#include "utils/FlatSet.h"
+#include "utils/sorted_vector_insert.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+long volatile s_sink;
+
+double milliseconds(clock_type::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+// Return the number of milliseconds that one million lookups take.
+template<typename Contains>
+double lookups(std::vector<int> const& keys, Contains contains)
+{
+  long hits = 0;
+  auto const start = clock_type::now();
+  for (int i = 0; i < 1000000; ++i)
+    hits += contains(keys[(i * 7919L) % keys.size()] + (i & 1));
+  double const result = milliseconds(start);
+  s_sink = hits;
+  return result;
+}
+
+void benchmark(int n)
+{
+  std::mt19937 generator(n);
+  std::vector<int> keys(n);
+  for (int& key : keys)
+    key = generator() & ~1;     // Even, so that key + 1 is a miss.
+
+  auto start = clock_type::now();
+  utils::FlatSet<int> flat_set(keys.begin(), keys.end());
+  double const flat_set_build = milliseconds(start);
+
+  start = clock_type::now();
+  std::set<int> set(keys.begin(), keys.end());
+  double const set_build = milliseconds(start);
+
+  std::vector<int> sorted_vector;
+  double sorted_vector_build = -1;
+  if (n <= 100000)              // It's quadratic.
+  {
+    start = clock_type::now();
+    for (int key : keys)
+      utils::sorted_vector_insert(sorted_vector, key);
+    sorted_vector_build = milliseconds(start);
+  }
+
+  std::cout << "N = " << std::setw(7) << n << std::fixed << std::setprecision(1) <<
+    "  build: FlatSet " << flat_set_build << " ms, std::set " << set_build << " ms, sorted_vector_insert ";
+  if (sorted_vector_build < 0)
+    std::cout << "(skipped)";
+  else
+    std::cout << sorted_vector_build << " ms";
+  std::cout << "\n             1M lookups: FlatSet " << lookups(keys, [&](int key){ return flat_set.contains(key); }) <<
+    " ms, std::set " << lookups(keys, [&](int key){ return set.contains(key); }) << " ms";
+  if (sorted_vector_build >= 0)
+    std::cout << ", std::binary_search " << lookups(keys, [&](int key){ return std::binary_search(sorted_vector.begin(), sorted_vector.end(), key); }) << " ms";
+  std::cout << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  benchmark(1000);
+  benchmark(100000);
+  benchmark(1000000);
+}
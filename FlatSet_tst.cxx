@@ -0,0 +1,116 @@
+// Test of FlatSet, FlatMultiSet, FlatMap and the range version of sorted_vector_insert
+// against std::set, std::multiset and std::map.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -D_GLIBCXX_ASSERTIONS -I. FlatSet_tst.cxx
+//
+// and run it; it prints "Success!" or aborts with an error message.
+
+#include "sys.h"
+#include "utils/FlatMap.h"
+#include "utils/sorted_vector_insert.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+void check(bool condition, char const* what)
+{
+  if (!condition)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    std::abort();
+  }
+}
+
+// Apply random range insertions, single insertions and erasures to the flat containers and to the std containers.
+void test_sets()
+{
+  std::mt19937 generator(5);
+  for (int round = 0; round < 2000; ++round)
+  {
+    utils::FlatSet<int> flat_set;
+    utils::FlatMultiSet<int> flat_multiset;
+    std::set<int> set;
+    std::multiset<int> multiset;
+    std::vector<int> sorted_vector;
+    for (int k = 0; k < 5; ++k)
+    {
+      std::vector<int> keys(generator() % 50);
+      for (int& key : keys)
+        key = generator() % 100;
+      // Sometimes all new keys sort after the existing ones.
+      if (generator() % 3 == 0)
+        for (int& key : keys)
+          key += 100 * k;
+      flat_set.insert_range(keys.begin(), keys.end());
+      flat_multiset.insert_range(keys.begin(), keys.end());
+      set.insert(keys.begin(), keys.end());
+      multiset.insert(keys.begin(), keys.end());
+      utils::sorted_vector_insert(sorted_vector, keys.begin(), keys.end());
+      if (generator() % 2)
+      {
+        int key = generator() % 100;
+        check(flat_set.insert(key).second == set.insert(key).second, "insert");
+        flat_multiset.insert(key);
+        multiset.insert(key);
+        utils::sorted_vector_insert(sorted_vector, key);
+      }
+      if (generator() % 2)
+      {
+        int key = generator() % 100;
+        check(flat_set.erase(key) == set.erase(key), "FlatSet::erase");
+        check(flat_multiset.erase(key) == multiset.erase(key), "FlatMultiSet::erase");
+        sorted_vector.erase(std::remove(sorted_vector.begin(), sorted_vector.end(), key), sorted_vector.end());
+      }
+    }
+    check(std::equal(flat_set.begin(), flat_set.end(), set.begin(), set.end()), "FlatSet contents");
+    check(std::equal(flat_multiset.begin(), flat_multiset.end(), multiset.begin(), multiset.end()), "FlatMultiSet contents");
+    check(std::equal(sorted_vector.begin(), sorted_vector.end(), multiset.begin(), multiset.end()), "sorted_vector_insert contents");
+    for (int key = -1; key < 600; ++key)
+    {
+      check(flat_set.contains(key) == set.contains(key), "FlatSet::contains");
+      check(flat_multiset.count(key) == multiset.count(key), "FlatMultiSet::count");
+      check(flat_multiset.lower_bound(key) - flat_multiset.begin() == std::distance(multiset.begin(), multiset.lower_bound(key)), "FlatMultiSet::lower_bound");
+      check(flat_multiset.upper_bound(key) - flat_multiset.begin() == std::distance(multiset.begin(), multiset.upper_bound(key)), "FlatMultiSet::upper_bound");
+    }
+  }
+}
+
+// With unique keys the first inserted element wins, just like std::map.
+void test_map()
+{
+  std::vector<std::pair<std::string, int>> const pairs{{"b", 1}, {"a", 2}, {"b", 3}};
+  utils::FlatMap<std::string, int> flat_map(pairs.begin(), pairs.end());
+  std::map<std::string, int> map(pairs.begin(), pairs.end());
+  flat_map["c"] = 5;
+  map["c"] = 5;
+  flat_map["a"] += 10;
+  map["a"] += 10;
+  flat_map.find("b")->second += 100;
+  map.find("b")->second += 100;
+  check(std::vector<std::pair<std::string, int>>(map.begin(), map.end()) == flat_map.values(), "FlatMap contents");
+  check(flat_map.at("b") == 101, "FlatMap::at");
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  test_sets();
+  test_map();
+
+  std::cout << "Success!" << std::endl;
+}
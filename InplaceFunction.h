@@ -0,0 +1,196 @@
+#pragma once
+
+#include "debug.h"
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// InplaceFunction
+//
+// An owning, move-only Callable (like std::function), that stores the callable
+// object inside itself: it never allocates memory. If the callable (for example,
+// a lambda with its captures) is larger than Capacity bytes then that is a
+// compile error.
+//
+// Use FunctionView when the callable doesn't have to be stored; use
+// InplaceFunction instead of std::function when it does.
+//
+// Usage:
+//
+//   std::vector<utils::InplaceFunction<void(int)>> callbacks;
+//   callbacks.emplace_back([this, &counter](int n){ counter += n; });
+//   for (auto& callback : callbacks)
+//     callback(42);
+//
+//   utils::InplaceFunction<void(), 64> f = [big_capture](){ ... };    // Room for 64 bytes of captures.
+//
+// The default Capacity is room for three pointers, which makes an InplaceFunction
+// as large as a std::function (with libstdc++).
+//
+namespace utils {
+namespace detail::inplace_function {
+
+template<typename R, typename... Args>
+struct VTable
+{
+  R (*m_invoke)(void* storage, Args&&... args);
+  // Move-construct the callable at dst from the one at src and destroy the one at src; nullptr if a memcpy suffices.
+  void (*m_relocate)(void* dst, void* src);
+  // Destroy the callable; nullptr if it is trivially destructible.
+  void (*m_destroy)(void* storage);
+};
+
+template<typename F, typename R, typename... Args>
+R invoke(void* storage, Args&&... args)
+{
+  if constexpr (std::is_void_v<R>)
+    std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+  else
+    return std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+}
+
+template<typename F>
+void relocate(void* dst, void* src)
+{
+  F* f = static_cast<F*>(src);
+  ::new (dst) F(std::move(*f));
+  f->~F();
+}
+
+template<typename F>
+void destroy(void* storage)
+{
+  static_cast<F*>(storage)->~F();
+}
+
+template<typename F, typename R, typename... Args>
+inline constexpr VTable<R, Args...> vtable = {
+  &invoke<F, R, Args...>,
+  std::is_trivially_copyable_v<F> ? nullptr : &relocate<F>,
+  std::is_trivially_destructible_v<F> ? nullptr : &destroy<F>
+};
+
+} // namespace detail::inplace_function
+
+template<typename Signature, size_t Capacity = 3 * sizeof(void*)>
+class InplaceFunction;  // Undefined.
+
+template<typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+ private:
+  using vtable_type = detail::inplace_function::VTable<R, Args...>;
+
+  alignas(std::max_align_t) mutable std::byte m_storage[Capacity];
+  vtable_type const* m_vtable;                  // nullptr if empty.
+
+  template<typename Signature, size_t OtherCapacity>
+  friend class InplaceFunction;
+
+  // Take over the callable of other, which is left empty.
+  template<size_t OtherCapacity>
+  void move_from(InplaceFunction<R(Args...), OtherCapacity>& other) noexcept
+  {
+    m_vtable = other.m_vtable;
+    if (!m_vtable)
+      return;
+    if (m_vtable->m_relocate)
+      m_vtable->m_relocate(m_storage, other.m_storage);
+    else
+      std::memcpy(m_storage, other.m_storage, OtherCapacity);
+    other.m_vtable = nullptr;
+  }
+
+ public:
+  // Create an empty InplaceFunction.
+  InplaceFunction() noexcept : m_vtable(nullptr) { }
+  InplaceFunction(std::nullptr_t) noexcept : m_vtable(nullptr) { }
+
+  // Store a copy of (or move) f, which can be any callable that can be called with Args and returns something convertible to R.
+  template<typename F, typename D = std::decay_t<F>>
+  requires (!std::is_same_v<D, InplaceFunction> && std::is_invocable_r_v<R, D&, Args...>)
+  InplaceFunction(F&& f)
+  {
+    static_assert(sizeof(D) <= Capacity, "The callable doesn't fit in this InplaceFunction: increase its Capacity.");
+    static_assert(alignof(D) <= alignof(std::max_align_t), "The callable is over-aligned.");
+    static_assert(std::is_nothrow_move_constructible_v<D>, "The callable must be nothrow move constructible.");
+    if constexpr (std::is_pointer_v<D> || std::is_member_pointer_v<D>)
+    {
+      // Like std::function, a null (member) function pointer results in an empty InplaceFunction.
+      if (f == nullptr)
+      {
+        m_vtable = nullptr;
+        return;
+      }
+    }
+    ::new (m_storage) D(std::forward<F>(f));
+    m_vtable = &detail::inplace_function::vtable<D, R, Args...>;
+  }
+
+  InplaceFunction(InplaceFunction&& other) noexcept { move_from(other); }
+
+  // Move from an InplaceFunction with a smaller capacity.
+  template<size_t OtherCapacity>
+  requires (OtherCapacity < Capacity)
+  InplaceFunction(InplaceFunction<R(Args...), OtherCapacity>&& other) noexcept { move_from(other); }
+
+  InplaceFunction& operator=(InplaceFunction&& other) noexcept
+  {
+    if (this != &other)
+    {
+      reset();
+      move_from(other);
+    }
+    return *this;
+  }
+
+  InplaceFunction& operator=(std::nullptr_t) noexcept
+  {
+    reset();
+    return *this;
+  }
+
+  template<typename F>
+  requires (!std::is_same_v<std::decay_t<F>, InplaceFunction> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+  InplaceFunction& operator=(F&& f)
+  {
+    return *this = InplaceFunction(std::forward<F>(f));
+  }
+
+  InplaceFunction(InplaceFunction const&) = delete;
+  InplaceFunction& operator=(InplaceFunction const&) = delete;
+
+  ~InplaceFunction() { reset(); }
+
+  // Destroy the stored callable, if any.
+  void reset() noexcept
+  {
+    if (m_vtable && m_vtable->m_destroy)
+      m_vtable->m_destroy(m_storage);
+    m_vtable = nullptr;
+  }
+
+  void swap(InplaceFunction& other) noexcept
+  {
+    InplaceFunction tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  R operator()(Args... args) const
+  {
+    // Calling an empty InplaceFunction.
+    ASSERT(m_vtable);
+    return m_vtable->m_invoke(m_storage, std::forward<Args>(args)...);
+  }
+
+  // Returns true if we have a callable, false if we don't (i.e., we're empty).
+  explicit operator bool() const { return m_vtable; }
+
+  friend bool operator==(InplaceFunction const& f, std::nullptr_t) { return !f.m_vtable; }
+};
+
+} // namespace utils
@@ -0,0 +1,87 @@
+// Benchmark of InplaceFunction versus std::function and FunctionView.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. InplaceFunction_bench.cxx
+//
+// It measures the cost of constructing (from a lambda with 24 bytes of captures), calling
+// once and destroying each callable, and the cost of calling an existing callable.
+
+#include "sys.h"
+#include "utils/InplaceFunction.h"
+#include "utils/FunctionView.h"
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+long volatile s_sink;
+
+using clock_type = std::chrono::steady_clock;
+
+double nanoseconds(clock_type::duration duration, long count)
+{
+  return std::chrono::duration<double, std::nano>(duration).count() / count;
+}
+
+// Not inlined, so that the call goes through the type erasure.
+template<typename Function>
+[[gnu::noinline]] long call(Function const& function, long x)
+{
+  return function(x);
+}
+
+template<typename Make>
+void construct_call_destroy(char const* name, Make make)
+{
+  constexpr int count = 10000000;
+  long a = 1, b = 2, c = 3;
+  long sum = 0;
+  auto const start = clock_type::now();
+  for (int i = 0; i < count; ++i)
+  {
+    a = i;
+    sum += make([a, b, c](long x){ return x + a + b + c; });
+  }
+  double const ns = nanoseconds(clock_type::now() - start, count);
+  s_sink = sum;
+  std::cout << std::left << std::setw(18) << name << std::fixed << std::setprecision(2) << "construct+call+destroy: " << ns << " ns" << std::endl;
+}
+
+template<typename Function>
+void call_only(char const* name, Function const& function)
+{
+  constexpr int count = 100000000;
+  long sum = 0;
+  auto const start = clock_type::now();
+  for (int i = 0; i < count; ++i)
+    sum += call(function, i);
+  double const ns = nanoseconds(clock_type::now() - start, count);
+  s_sink = sum;
+  std::cout << std::left << std::setw(18) << name << std::fixed << std::setprecision(2) << "call: " << ns << " ns" << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  for (int i = 0; i < 2; ++i)
+  {
+    construct_call_destroy("std::function", [](auto&& lambda){ std::function<long(long)> f = lambda; return call(f, 1); });
+    construct_call_destroy("InplaceFunction", [](auto&& lambda){ utils::InplaceFunction<long(long)> f = lambda; return call(f, 1); });
+    construct_call_destroy("FunctionView", [](auto&& lambda){ utils::FunctionView<long(long)> f = lambda; return call(f, 1); });
+  }
+
+  long a = 1, b = 2, c = 3;
+  auto lambda = [a, b, c](long x){ return x + a + b + c; };
+  std::function<long(long)> standard_function = lambda;
+  utils::InplaceFunction<long(long)> inplace_function = lambda;
+  utils::FunctionView<long(long)> function_view = lambda;
+  call_only("std::function", standard_function);
+  call_only("InplaceFunction", inplace_function);
+  call_only("FunctionView", function_view);
+}
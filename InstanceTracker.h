@@ -29,7 +29,11 @@
 
 #include "threadsafe/aithreadsafe.h"
 #include "utils/print_using.h"
+#include "utils/FunctionView.h"
 #include <set>
+#include <array>
+#include <mutex>
+#include <atomic>
 #include "debug.h"
 
 #if defined(CWDEBUG) && !defined(DOXYGEN)
@@ -40,6 +44,24 @@ NAMESPACE_DEBUG_CHANNELS_END
 
 namespace utils {
 
+namespace instance_tracker {
+
+// The registration mode of InstanceTracker.
+//
+// serialized : All instances are stored in a single std::set, protected by a mutex (the default).
+// sharded    : Each instance is linked into one of `number_of_shards` intrusive lists, each with
+//              its own mutex, selected by the constructing thread. Use this for objects that are
+//              created and destroyed at a high rate, by many threads.
+struct serialized { };
+struct sharded { };
+
+static constexpr int number_of_shards = 32;
+
+} // namespace instance_tracker
+
+template<typename T, typename Mode = instance_tracker::serialized>
+class InstanceTracker;
+
 namespace detail {
 class InstanceCollectionTracker;
 } // namespace detail
@@ -103,7 +125,7 @@ class InstanceCollection : public InstanceCollectionTracker
     collection_w->erase(instance);
   }
 
-  void for_each_instance(std::function<void(T const*)> const& func) const
+  void for_each_instance(FunctionView<void(T const*)> func) const
   {
     typename collection_t::crat collection_r(m_collection);
     for (T const* instance : *collection_r)
@@ -125,9 +147,94 @@ class InstanceCollection : public InstanceCollectionTracker
 #endif
 };
 
-} // namespace detail
+// The intrusive list node of an instance tracked with instance_tracker::sharded.
+struct InstanceTrackerNode
+{
+  InstanceTrackerNode* m_prev;
+  InstanceTrackerNode* m_next;
+  int m_shard;
+};
+
+// Return the shard that the current thread adds instances to.
+inline int this_thread_instance_tracker_shard()
+{
+  static std::atomic<unsigned int> s_next_shard;
+  thread_local int const shard = s_next_shard.fetch_add(1, std::memory_order_relaxed) % instance_tracker::number_of_shards;
+  return shard;
+}
 
 template<typename T>
+class ShardedInstanceCollection : public InstanceCollectionTracker
+{
+ private:
+  // Each shard is a circular doubly linked list with a sentinel, on its own cache line.
+  struct alignas(config::cacheline_size_c) Shard
+  {
+    mutable std::mutex m_mutex;
+    InstanceTrackerNode m_head;
+  };
+
+  std::array<Shard, instance_tracker::number_of_shards> m_shards;
+
+ public:
+  ShardedInstanceCollection()
+  {
+    for (Shard& shard : m_shards)
+      shard.m_head.m_prev = shard.m_head.m_next = &shard.m_head;
+  }
+
+  void add(InstanceTrackerNode* node)
+  {
+    node->m_shard = this_thread_instance_tracker_shard();
+    Shard& shard = m_shards[node->m_shard];
+    std::lock_guard<std::mutex> lock(shard.m_mutex);
+    node->m_prev = &shard.m_head;
+    node->m_next = shard.m_head.m_next;
+    node->m_next->m_prev = node;
+    shard.m_head.m_next = node;
+  }
+
+  // The instance might be destroyed by a different thread than the one that created it,
+  // therefore use the shard that was stored in the node.
+  void remove(InstanceTrackerNode* node)
+  {
+    std::lock_guard<std::mutex> lock(m_shards[node->m_shard].m_mutex);
+    node->m_prev->m_next = node->m_next;
+    node->m_next->m_prev = node->m_prev;
+  }
+
+  // All shards are locked while func is called, so that - just like with a single
+  // collection - the instances passed to func are a snapshot: no instance can be added
+  // or removed in the meantime.
+  void for_each_instance(FunctionView<void(T const*)> func) const
+  {
+    std::array<std::unique_lock<std::mutex>, instance_tracker::number_of_shards> locks;
+    // Always lock the shards in the same order.
+    for (int i = 0; i < instance_tracker::number_of_shards; ++i)
+      locks[i] = std::unique_lock<std::mutex>(m_shards[i].m_mutex);
+    for (Shard const& shard : m_shards)
+      for (InstanceTrackerNode const* node = shard.m_head.m_next; node != &shard.m_head; node = node->m_next)
+        func(static_cast<T const*>(static_cast<InstanceTracker<T, instance_tracker::sharded> const*>(node)));
+  }
+
+ private:
+#ifdef CWDEBUG
+  // Implementation of base class interface.
+  void dump() const override
+  {
+    Dout(dc::tracker, "Instances of " << type_info_of<T>().demangled_name() << ":");
+    debug::Indent indent(2);
+    for_each_instance([&](T const* instance)
+    {
+      Dout(dc::tracker, utils::print_using(*instance, &T::print_tracker_info_on));
+    });
+  }
+#endif
+};
+
+} // namespace detail
+
+template<typename T, typename Mode>
 class InstanceTracker
 {
  private:
@@ -145,13 +252,52 @@ class InstanceTracker
   }
 
  public:
-  static void for_each_instance(std::function<void(T const*)> const& func)
+  static void for_each_instance(FunctionView<void(T const*)> func)
+  {
+    s_collection.for_each_instance(func);
+  }
+};
+
+template<typename T, typename Mode>
+typename detail::InstanceCollection<T> InstanceTracker<T, Mode>::s_collection;
+
+// Usage:
+//
+// class Foo : public utils::InstanceTracker<Foo, utils::instance_tracker::sharded>
+//
+// Construction and destruction of Foo then do not allocate memory and only lock
+// one of instance_tracker::number_of_shards mutexes.
+//
+template<typename T>
+class InstanceTracker<T, instance_tracker::sharded> : private detail::InstanceTrackerNode
+{
+ private:
+  friend class detail::ShardedInstanceCollection<T>;
+  static detail::ShardedInstanceCollection<T> s_collection;
+
+ protected:
+  InstanceTracker()
+  {
+    s_collection.add(this);
+  }
+
+  // A copy is a new instance; don't copy the links.
+  InstanceTracker(InstanceTracker const&) : InstanceTracker() { }
+  InstanceTracker& operator=(InstanceTracker const&) { return *this; }
+
+  ~InstanceTracker()
+  {
+    s_collection.remove(this);
+  }
+
+ public:
+  static void for_each_instance(FunctionView<void(T const*)> func)
   {
     s_collection.for_each_instance(func);
   }
 };
 
 template<typename T>
-typename detail::InstanceCollection<T> InstanceTracker<T>::s_collection;
+typename detail::ShardedInstanceCollection<T> InstanceTracker<T, instance_tracker::sharded>::s_collection;
 
 } // namespace utils
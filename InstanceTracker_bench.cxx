@@ -0,0 +1,71 @@
+// Benchmark of the construction and destruction of tracked instances, serialized versus sharded.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. InstanceTracker_bench.cxx utils/InstanceTracker.cxx
+//
+// It measures the total throughput of 1, 2, 4, ..., 64 threads that each keep constructing
+// and destroying instances (a few of them alive at any time), for both registration modes.
+// The results are only meaningful on a machine with at least as many cores as threads.
+
+#include "sys.h"
+#include "utils/InstanceTracker.h"
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Serialized : utils::InstanceTracker<Serialized>
+{
+  void print_tracker_info_on(std::ostream& os) const { os << "Serialized"; }
+};
+
+struct Sharded : utils::InstanceTracker<Sharded, utils::instance_tracker::sharded>
+{
+  void print_tracker_info_on(std::ostream& os) const { os << "Sharded"; }
+};
+
+using clock_type = std::chrono::steady_clock;
+
+// Return the number of million constructions plus destructions per second.
+template<typename T>
+double throughput(int number_of_threads)
+{
+  constexpr int iterations = 200000;            // Per thread.
+  constexpr int alive = 8;                      // Instances alive per thread.
+
+  std::vector<std::thread> threads;
+  auto const start = clock_type::now();
+  for (int t = 0; t < number_of_threads; ++t)
+    threads.emplace_back([]{
+      std::array<std::unique_ptr<T>, alive> instances;
+      for (int i = 0; i < iterations; ++i)
+        instances[i % alive] = std::make_unique<T>();
+    });
+  for (auto& thread : threads)
+    thread.join();
+  double const seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+  return number_of_threads * static_cast<double>(iterations) / seconds / 1e6;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  std::cout << "hardware threads: " << std::thread::hardware_concurrency() << '\n';
+  std::cout << "threads  serialized (M/s)  sharded (M/s)\n";
+  for (int number_of_threads = 1; number_of_threads <= 64; number_of_threads *= 2)
+  {
+    double const serialized = throughput<Serialized>(number_of_threads);
+    double const sharded = throughput<Sharded>(number_of_threads);
+    std::cout << std::setw(7) << number_of_threads << std::fixed << std::setprecision(2) <<
+      std::setw(19) << serialized << std::setw(15) << sharded << std::endl;
+  }
+}
@@ -0,0 +1,66 @@
+#include "sys.h"
+#include "InternedString.h"
+#include <vector>
+#include <algorithm>
+
+namespace utils {
+
+namespace {
+
+struct Entry
+{
+  uint64_t hash;
+  std::string_view name;
+  InternedString::id_type* id_out;
+};
+
+// Sorted on hash (and name) once finish_registration() is done; the index is the id.
+// This must be a function-local static because it is used from Register callbacks.
+std::vector<Entry>& entries()
+{
+  static std::vector<Entry> s_entries;
+  return s_entries;
+}
+
+} // namespace
+
+//static
+void InternedString::add(std::string_view name, uint64_t hash, id_type* id_out, size_t number_of_literals)
+{
+  std::vector<Entry>& table = entries();
+  table.push_back({ hash, name, id_out });
+  if (table.size() < number_of_literals)
+    return;
+  // All literals were added; assign the ids.
+  std::sort(table.begin(), table.end(), [](Entry const& e1, Entry const& e2){ return e1.hash < e2.hash || (e1.hash == e2.hash && e1.name < e2.name); });
+  ASSERT(table.size() < undefined_id);
+  for (id_type id = 0; id < table.size(); ++id)
+    *table[id].id_out = id;
+}
+
+//static
+InternedString InternedString::lookup(std::string_view name)
+{
+  std::vector<Entry> const& table = entries();
+  uint64_t hash = template_string_literal::hash(name);
+  auto iter = std::lower_bound(table.begin(), table.end(), hash, [](Entry const& entry, uint64_t hash){ return entry.hash < hash; });
+  // Normally this loop runs at most once: only in the case of a hash collision there can be more than one entry with the same hash.
+  for (; iter != table.end() && iter->hash == hash; ++iter)
+    if (iter->name == name)
+      return InternedString{static_cast<id_type>(iter - table.begin())};
+  return {};
+}
+
+//static
+size_t InternedString::size()
+{
+  return entries().size();
+}
+
+std::string_view InternedString::name() const
+{
+  ASSERT(m_id < entries().size());
+  return entries()[m_id].name;
+}
+
+} // namespace utils
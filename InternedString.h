@@ -0,0 +1,98 @@
+#pragma once
+
+#include "TemplateStringLiteral.h"
+#include "Register.h"
+#include "debug.h"
+#include <string_view>
+#include <cstdint>
+#include <limits>
+#include <compare>
+
+// Compile-time string interning.
+//
+// Every distinct string literal that is used as utils::interned<"..."> (anywhere in the program)
+// is given a small integer id, so that comparing such names becomes an integer compare.
+//
+// Usage:
+//
+//   int main()
+//   {
+//     Debug(debug::init());
+//     utils::RegisterGlobals::finish_registration();     // Ids are assigned here.
+//
+//     utils::InternedString name = utils::InternedString::lookup(read_name_from_input());
+//     if (name == utils::interned<"foo">())              // Integer compare.
+//       ...
+//
+// The ids are assigned from utils::RegisterGlobals::finish_registration(), not during static
+// initialization, so that they do not depend on the (unspecified) order of dynamic initialization
+// or on link order: all literals are sorted on their hash and the id is the position in that
+// sorted list. Hence ids are stable between runs of the same program; moreover lookup(std::string_view)
+// is a binary search on the runtime computed hash.
+//
+// Do not use an id before finish_registration() was called (this is asserted in debug mode).
+//
+namespace utils {
+
+class InternedString
+{
+ public:
+  using id_type = uint32_t;
+  static constexpr id_type undefined_id = std::numeric_limits<id_type>::max();
+
+ private:
+  id_type m_id;
+
+  // Called once for every interned literal from finish_registration().
+  static void add(std::string_view name, uint64_t hash, id_type* id_out, size_t number_of_literals);
+
+  // Storage for the id of an interned string literal S, and its registration.
+  template<TemplateStringLiteral S>
+  struct Literal
+  {
+    static constexpr std::string_view name = S;
+    static constexpr uint64_t hash = S.hash();
+    static inline id_type s_id = undefined_id;
+    static inline Register<InternedString> s_register{[](size_t number_of_literals){ add(name, hash, &s_id, number_of_literals); }};
+
+    static id_type id()
+    {
+      // Odr-use s_register so that it gets instantiated (and therefore constructed) for each S that is used.
+      static_cast<void>(&s_register);
+      // You are using an interned string before utils::RegisterGlobals::finish_registration() was called.
+      ASSERT(s_id != undefined_id);
+      return s_id;
+    }
+  };
+
+  constexpr explicit InternedString(id_type id) : m_id(id) { }
+
+ public:
+  // Default construct an InternedString that is not equal to any interned literal.
+  constexpr InternedString() : m_id(undefined_id) { }
+
+  // Return the InternedString for the literal S.
+  template<TemplateStringLiteral S>
+  static InternedString get() { return InternedString{Literal<S>::id()}; }
+
+  // Return the InternedString for name, or an undefined InternedString if name was never interned.
+  static InternedString lookup(std::string_view name);
+
+  // Return the total number of interned strings; ids run from 0 till size().
+  static size_t size();
+
+  id_type id() const { return m_id; }
+  bool is_defined() const { return m_id != undefined_id; }
+
+  // Return the string that was interned. Must be defined.
+  std::string_view name() const;
+
+  friend bool operator==(InternedString lhs, InternedString rhs) { return lhs.m_id == rhs.m_id; }
+  // Ordering is on id, which is the order of the hashes; not alphabetical.
+  friend std::strong_ordering operator<=>(InternedString lhs, InternedString rhs) { return lhs.m_id <=> rhs.m_id; }
+};
+
+template<TemplateStringLiteral S>
+InternedString interned() { return InternedString::get<S>(); }
+
+} // namespace utils
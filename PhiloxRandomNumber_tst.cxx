@@ -0,0 +1,131 @@
+// Test of PhiloxRandomNumber: the philox4x32_10 known-answer vectors of Random123, and
+// the determinism guarantee of bulk generation (filling an array in chunks with
+// jump(begin) + generate(subspan) gives the same values as filling it at once).
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -D_GLIBCXX_ASSERTIONS -I. PhiloxRandomNumber_tst.cxx utils/RandomNumber.cxx
+//
+// and run it; it prints "Success!" or aborts with an error message.
+
+#include "sys.h"
+#include "utils/RandomNumber.h"
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <span>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+void check(bool condition, char const* what)
+{
+  if (!condition)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    std::abort();
+  }
+}
+
+using counter_type = std::array<uint32_t, 4>;
+using key_type = std::array<uint32_t, 2>;
+
+// The philox4x32_10 known-answer vectors from kat_vectors of Random123.
+static_assert(utils::PhiloxRandomNumber::philox(counter_type{0, 0, 0, 0}, key_type{0, 0}) ==
+    counter_type{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+static_assert(utils::PhiloxRandomNumber::philox(counter_type{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, key_type{0xffffffff, 0xffffffff}) ==
+    counter_type{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+static_assert(utils::PhiloxRandomNumber::philox(counter_type{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, key_type{0xa4093822, 0x299f31d0}) ==
+    counter_type{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+
+// The scalar outputs of a stream are the blocks of philox, two per block.
+void test_scalar()
+{
+  uint64_t const seed = 0x299f31d0a4093822;
+  uint64_t const stream = 0x0370734413198a2e;
+  utils::PhiloxRandomNumber rng(seed, stream);
+  for (uint64_t n = 0; n < 8; ++n)
+  {
+    counter_type const r = utils::PhiloxRandomNumber::philox(
+        { static_cast<uint32_t>(n), static_cast<uint32_t>(n >> 32), static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32) },
+        { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) });
+    check(rng() == (r[0] | uint64_t{r[1]} << 32), "first output of a block");
+    check(rng() == (r[2] | uint64_t{r[3]} << 32), "second output of a block");
+  }
+}
+
+// Bulk generation of raw bits returns the same values as the scalar operator(),
+// for every start position (even and odd) and length (around the 32 counters per iteration).
+void test_bulk_equals_scalar()
+{
+  for (uint64_t start : { 0, 1, 2, 5, 64, 1001 })
+    for (size_t n : { 0, 1, 2, 31, 32, 33, 63, 64, 65, 1000, 1001 })
+    {
+      utils::PhiloxRandomNumber bulk(42, 7), scalar(42, 7);
+      bulk.jump(start);
+      for (uint64_t i = 0; i < start; ++i)
+        scalar();
+      std::vector<uint64_t> out(n);
+      bulk.generate(std::span{out});
+      for (size_t i = 0; i < n; ++i)
+        check(out[i] == scalar(), "generate(span) equals operator()");
+      check(bulk.position() == scalar.position(), "position after generate(span)");
+      check(bulk() == scalar(), "operator() after generate(span)");
+    }
+}
+
+// Filling [begin, end) of an array with a generator that jumped to begin, for any
+// partitioning, must be bit-identical to filling the whole array with one generator.
+template<typename T, typename Fill>
+void test_chunked(char const* what, Fill fill)
+{
+  constexpr size_t size = 10007;
+  std::vector<T> whole(size);
+  {
+    utils::PhiloxRandomNumber rng(1234567, 3);
+    fill(rng, std::span{whole});
+  }
+  for (size_t chunks : { 1, 2, 3, 7, 64, 1000 })
+  {
+    std::vector<T> parts(size);
+    // Fill the chunks in reverse order, as threads might.
+    for (size_t t = chunks; t-- > 0;)
+    {
+      size_t const begin = size * t / chunks;
+      size_t const end = size * (t + 1) / chunks;
+      utils::PhiloxRandomNumber rng(1234567, 3);
+      rng.jump(begin);
+      fill(rng, std::span{parts}.subspan(begin, end - begin));
+    }
+    check(parts == whole, what);
+  }
+}
+
+void test_chunked_fills()
+{
+  test_chunked<uint64_t>("chunked generate(span<uint64_t>)", [](utils::PhiloxRandomNumber& rng, std::span<uint64_t> out){ rng.generate(out); });
+  test_chunked<double>("chunked generate(span<double>)", [](utils::PhiloxRandomNumber& rng, std::span<double> out){
+    std::uniform_real_distribution<double> distribution(-1.0, 2.0);
+    rng.generate(out, distribution);
+  });
+  test_chunked<float>("chunked generate(span<float>)", [](utils::PhiloxRandomNumber& rng, std::span<float> out){
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    rng.generate(out, distribution);
+  });
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  test_scalar();
+  test_bulk_equals_scalar();
+  test_chunked_fills();
+
+  std::cout << "Success!" << std::endl;
+}
@@ -22,4 +22,57 @@ RandomNumber::RandomNumber()
   seed(seed_value);
 }
 
+void PhiloxRandomNumber::generate_blocks(uint64_t first_block, uint64_t* __restrict__ out, size_t number_of_blocks) const
+{
+  // Encrypt this many counters at once, with separate arrays for each word of the counter, so that the
+  // compiler vectorizes the loops over the lanes (with fewer lanes gcc -O3 unrolls them completely instead).
+  constexpr size_t lanes = 32;
+  uint32_t const s0 = m_stream, s1 = m_stream >> 32;
+  for (; number_of_blocks >= lanes; number_of_blocks -= lanes, first_block += lanes, out += 2 * lanes)
+  {
+    uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+    for (size_t l = 0; l < lanes; ++l)
+    {
+      uint64_t n = first_block + l;
+      c0[l] = n;
+      c1[l] = n >> 32;
+      c2[l] = s0;
+      c3[l] = s1;
+    }
+    uint32_t k0 = m_key, k1 = m_key >> 32;
+    for (int r = 0; r < 10; ++r)
+    {
+      for (size_t l = 0; l < lanes; ++l)
+        round(c0[l], c1[l], c2[l], c3[l], k0, k1);
+      k0 += W0;
+      k1 += W1;
+    }
+    for (size_t l = 0; l < lanes; ++l)
+    {
+      out[2 * l] = c0[l] | uint64_t{c1[l]} << 32;
+      out[2 * l + 1] = c2[l] | uint64_t{c3[l]} << 32;
+    }
+  }
+  for (size_t b = 0; b < number_of_blocks; ++b)
+  {
+    block_type outputs = block(first_block + b);
+    out[2 * b] = outputs[0];
+    out[2 * b + 1] = outputs[1];
+  }
+}
+
+void PhiloxRandomNumber::generate(std::span<uint64_t> out)
+{
+  size_t i = 0;
+  // Finish the current block first.
+  if ((m_position & 1) && !out.empty())
+    out[i++] = (*this)();
+  size_t const number_of_blocks = (out.size() - i) / 2;
+  generate_blocks(m_position >> 1, out.data() + i, number_of_blocks);
+  i += 2 * number_of_blocks;
+  m_position += 2 * number_of_blocks;
+  if (i < out.size())
+    out[i] = (*this)();
+}
+
 } // namespace utils
@@ -29,6 +29,11 @@
 
 #include <random>
 #include <concepts>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <span>
 
 namespace utils {
 
@@ -72,4 +77,202 @@ class RandomNumber
   }
 };
 
+// PhiloxRandomNumber
+//
+// A counter-based random number generator: Philox4x32-10 (Salmon et al., "Parallel
+// random numbers: as easy as 1, 2, 3", SC11).
+//
+// The n-th output of a stream is a pure function of (seed, stream, n): the 128-bit
+// counter {n / 2, stream} is encrypted with the 64-bit seed as key, giving two 64-bit
+// outputs. Hence there is (almost) no state: seeding costs nothing, jump(n) skips n
+// outputs in constant time and every stream id gives an independent stream.
+//
+// In order to get results that do not depend on the number of threads, give every
+// unit of work (not every thread) its own stream, or its own range of one stream:
+//
+//   // Work item i uses stream i.
+//   utils::PhiloxRandomNumber rng(seed, i);
+//
+//   // Thread t fills out[begin, end) of one large array.
+//   utils::PhiloxRandomNumber rng(seed);
+//   rng.jump(begin);
+//   rng.generate(std::span{out}.subspan(begin, end - begin), distribution);
+//
+// The latter gives the same values as filling the whole array at once, because
+// generate uses exactly one output per value for raw bits (uint64_t) and for
+// std::uniform_real_distribution (which are generated by a vectorized loop); other
+// distributions may use a variable number of outputs per value.
+//
+// PhiloxRandomNumber is a UniformRandomBitGenerator, so it can be passed to any std
+// distribution too.
+//
+class PhiloxRandomNumber
+{
+ public:
+  using result_type = uint64_t;
+  using block_type = std::array<uint64_t, 2>;
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~result_type{0}; }
+
+ private:
+  uint64_t m_key;               // The seed.
+  uint64_t m_stream;            // The stream id: the upper half of the counter.
+  uint64_t m_position;          // The index of the next output in the stream.
+  uint64_t m_splits;            // The number of times that split() was called.
+  uint64_t m_next;              // The second output of block m_position / 2, if m_position is odd.
+
+  static constexpr uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;   // Multipliers.
+  static constexpr uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;   // Weyl sequence constants of the key schedule.
+
+  static constexpr void round(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3, uint32_t k0, uint32_t k1)
+  {
+    uint64_t p0 = uint64_t{M0} * c0;
+    uint64_t p1 = uint64_t{M1} * c2;
+    uint32_t const c1_in = c1, c3_in = c3;
+    c0 = static_cast<uint32_t>(p1 >> 32) ^ c1_in ^ k0;
+    c1 = static_cast<uint32_t>(p1);
+    c2 = static_cast<uint32_t>(p0 >> 32) ^ c3_in ^ k1;
+    c3 = static_cast<uint32_t>(p0);
+  }
+
+  // Fill out with the 2 * number_of_blocks outputs of blocks first_block, first_block + 1, ...
+  void generate_blocks(uint64_t first_block, uint64_t* out, size_t number_of_blocks) const;
+
+  void load_next()
+  {
+    if ((m_position & 1))
+      m_next = block(m_position >> 1)[1];
+  }
+
+ public:
+  PhiloxRandomNumber(result_type seed_in = 0, uint64_t stream = 0) : m_key(seed_in), m_stream(stream), m_position(0), m_splits(0), m_next(0) { }
+
+  template<class SeedSequence>
+  requires (!std::convertible_to<SeedSequence, result_type>)
+  PhiloxRandomNumber(SeedSequence& seed_sequence, uint64_t stream = 0) : m_stream(stream), m_next(0)
+  {
+    seed(seed_sequence);
+  }
+
+  // Select the beginning of stream stream() of seed seed_in.
+  void seed(result_type seed_in)
+  {
+    m_key = seed_in;
+    m_position = 0;
+    m_splits = 0;
+  }
+
+  template<class SeedSequence>
+  requires (!std::convertible_to<SeedSequence, result_type>)
+  void seed(SeedSequence& seed_sequence)
+  {
+    std::array<uint32_t, 2> key;
+    seed_sequence.generate(key.begin(), key.end());
+    seed(key[0] | uint64_t{key[1]} << 32);
+  }
+
+  // The Philox4x32-10 bijection: encrypt counter {c0, c1, c2, c3} with key {k0, k1}.
+  static constexpr std::array<uint32_t, 4> philox(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key)
+  {
+    auto [c0, c1, c2, c3] = counter;
+    auto [k0, k1] = key;
+    for (int r = 0; r < 10; ++r)
+    {
+      if (r > 0)
+      {
+        k0 += W0;
+        k1 += W1;
+      }
+      round(c0, c1, c2, c3, k0, k1);
+    }
+    return { c0, c1, c2, c3 };
+  }
+
+  // Return the two outputs with index 2 * n and 2 * n + 1 of this stream.
+  block_type block(uint64_t n) const
+  {
+    auto [x0, x1, x2, x3] = philox(
+        { static_cast<uint32_t>(n), static_cast<uint32_t>(n >> 32), static_cast<uint32_t>(m_stream), static_cast<uint32_t>(m_stream >> 32) },
+        { static_cast<uint32_t>(m_key), static_cast<uint32_t>(m_key >> 32) });
+    return { x0 | uint64_t{x1} << 32, x2 | uint64_t{x3} << 32 };
+  }
+
+  result_type operator()()
+  {
+    uint64_t position = m_position++;
+    if ((position & 1))
+      return m_next;
+    block_type outputs = block(position >> 1);
+    m_next = outputs[1];
+    return outputs[0];
+  }
+
+  // Skip the next n outputs.
+  void jump(uint64_t n)
+  {
+    m_position += n;
+    load_next();
+  }
+
+  // For compatibility with the std engines.
+  void discard(unsigned long long n) { jump(n); }
+
+  // Return a generator for a new stream that is derived from this one.
+  // The result only depends on the seed and stream of this object and the number of
+  // previous calls to split(), so a tree of streams (for example, of recursive tasks)
+  // is reproducible. The new stream id is pseudo-random, so among N streams obtained
+  // this way the chance of a collision is about N^2 / 2^65.
+  PhiloxRandomNumber split()
+  {
+    // Use a different key than the one of the outputs, so that the new stream id is not one of the outputs of this stream.
+    auto [x0, x1, x2, x3] = philox(
+        { static_cast<uint32_t>(m_splits), static_cast<uint32_t>(m_splits >> 32), static_cast<uint32_t>(m_stream), static_cast<uint32_t>(m_stream >> 32) },
+        { static_cast<uint32_t>(m_key) ^ 0x5bd1e995, static_cast<uint32_t>(m_key >> 32) ^ 0x27d4eb2f });
+    ++m_splits;
+    return { m_key, x0 | uint64_t{x1} << 32 };
+  }
+
+  result_type seed() const { return m_key; }
+  uint64_t stream() const { return m_stream; }
+  uint64_t position() const { return m_position; }
+
+  template<std::integral INT>
+  INT generate(std::uniform_int_distribution<INT>& distribution)
+  {
+    return distribution(*this);
+  }
+
+  // Fill out with the next out.size() outputs.
+  void generate(std::span<uint64_t> out);
+
+  // Fill out with random values in [a, b), using one output per value.
+  template<std::floating_point FLOAT>
+  requires (std::numeric_limits<FLOAT>::digits < 64)
+  void generate(std::span<FLOAT> out, std::uniform_real_distribution<FLOAT>& distribution)
+  {
+    static constexpr int mantissa_bits = std::numeric_limits<FLOAT>::digits;
+    static constexpr FLOAT scale = FLOAT{1} / (uint64_t{1} << mantissa_bits);
+    FLOAT const a = distribution.a();
+    FLOAT const range = distribution.b() - a;
+    std::array<uint64_t, 256> bits;
+    while (!out.empty())
+    {
+      size_t const count = std::min(out.size(), bits.size());
+      generate(std::span<uint64_t>{bits.data(), count});
+      for (size_t i = 0; i < count; ++i)
+        out[i] = a + range * (static_cast<FLOAT>(bits[i] >> (64 - mantissa_bits)) * scale);
+      out = out.subspan(count);
+    }
+  }
+
+  // Fill out with values of any other distribution.
+  template<typename T, typename Distribution>
+  void generate(std::span<T> out, Distribution& distribution)
+  {
+    for (T& value : out)
+      value = distribution(*this);
+  }
+};
+
 } // namespace utils
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "InplaceFunction.h"
 #include <vector>
 #include <functional>
+#include <type_traits>
 
 // Register global (POD) types and do callbacks per object once main is reached.
 //
@@ -78,16 +80,30 @@ template<typename T>
 class Register : public RegisterGlobals
 {
  private:
-  static std::vector<std::function<void(size_t)>> s_global_objects;
+  // Callbacks are stored without allocating memory per callback; the capacity is large
+  // enough that a std::function<void(size_t)> can still be passed.
+  static constexpr size_t capacity = sizeof(std::function<void(size_t)>);
+  using callback_type = InplaceFunction<void(size_t), capacity>;
+  static std::vector<callback_type> s_global_objects;
+
+  // True if a callable of type D can be stored in a callback_type directly.
+  template<typename D>
+  static constexpr bool fits_v = sizeof(D) <= capacity && alignof(D) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<D>;
 
  public:
-  Register(std::function<void(size_t)> callback)
+  Register(callback_type callback)
   {
     if (s_global_objects.empty())
       RegisterGlobals::add(this);
     s_global_objects.emplace_back(std::move(callback));
   }
 
+  // Callables that don't fit in a callback_type (larger captures, or a move constructor
+  // that can throw) are wrapped in a std::function, which allocates memory for them.
+  template<typename F>
+  requires (std::is_invocable_v<std::decay_t<F>&, size_t> && !fits_v<std::decay_t<F>>)
+  Register(F&& callback) : Register(callback_type(std::function<void(size_t)>(std::forward<F>(callback)))) { }
+
  private:
   static void do_finish()
   {
@@ -103,6 +119,6 @@ class Register : public RegisterGlobals
 };
 
 template<typename T>
-std::vector<std::function<void(size_t)>> Register<T>::s_global_objects;
+std::vector<typename Register<T>::callback_type> Register<T>::s_global_objects;
 
 } // namespace utils
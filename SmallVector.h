@@ -0,0 +1,42 @@
+#pragma once
+
+#include "VectorIndex.h"
+#include <boost/container/small_vector.hpp>
+
+namespace utils {
+
+// Like utils::Vector, but with inline storage for N elements: it only allocates memory
+// when it grows beyond N elements. Uses the same (typed) index as utils::Vector.
+//
+// Usage:
+//
+//   utils::SmallVector<Node, 8> nodes;        // No heap allocation until a ninth element is added.
+//   for (auto index = nodes.ibegin(); index != nodes.iend(); ++index)
+//     nodes[index].process();
+//
+template <typename T, std::size_t N, typename _Index = VectorIndex<T>, typename _Alloc = void>
+class SmallVector : public boost::container::small_vector<T, N, _Alloc>
+{
+ protected:
+  using _Base = boost::container::small_vector<T, N, _Alloc>;
+
+ public:
+  using reference = typename _Base::reference;
+  using const_reference = typename _Base::const_reference;
+  using index_type = _Index;
+
+  using boost::container::small_vector<T, N, _Alloc>::small_vector;
+  using boost::container::small_vector<T, N, _Alloc>::operator=;
+
+ public:
+  reference operator[](index_type __n) noexcept { return _Base::operator[](static_cast<size_t>(__n)); }
+  const_reference operator[](index_type __n) const noexcept { return _Base::operator[](static_cast<size_t>(__n)); }
+
+  reference at(index_type __n) { return _Base::at(static_cast<size_t>(__n)); }
+  const_reference at(index_type __n) const { return _Base::at(static_cast<size_t>(__n)); }
+
+  index_type ibegin() const { return index_type(size_t{0}); }
+  index_type iend() const { return index_type(_Base::size()); }
+};
+
+} // namespace utils
@@ -0,0 +1,79 @@
+// Benchmark of SmallVector versus Vector.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. SmallVector_bench.cxx
+//
+// For vectors with n 8-byte elements it measures the latency of constructing a vector,
+// pushing n elements, iterating over them and destroying it, and the memory used per
+// vector (the object itself plus its heap memory, according to glibc's mallinfo2).
+
+#include "sys.h"
+#include "utils/SmallVector.h"
+#include "utils/Vector.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+struct Element { int m_a; int m_b; };
+
+using clock_type = std::chrono::steady_clock;
+
+long volatile s_sink;
+
+template<typename V>
+double latency(int n)
+{
+  constexpr int rounds = 1000000;
+  long sum = 0;
+  auto const start = clock_type::now();
+  for (int i = 0; i < rounds; ++i)
+  {
+    V v;
+    for (int k = 0; k < n; ++k)
+      v.push_back(Element{k, i});
+    for (auto index = v.ibegin(); index != v.iend(); ++index)
+      sum += v[index].m_a;
+    asm volatile ("" ::: "memory");
+  }
+  s_sink = sum;
+  return std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / rounds;
+}
+
+template<typename V>
+double bytes_per_vector(int n)
+{
+  constexpr int count = 100000;
+  std::vector<V> vectors(count);
+  size_t const before = mallinfo2().uordblks;
+  for (V& v : vectors)
+    for (int k = 0; k < n; ++k)
+      v.push_back(Element{k, 0});
+  return sizeof(V) + static_cast<double>(mallinfo2().uordblks - before) / count;
+}
+
+template<size_t N>
+void benchmark()
+{
+  using Small = utils::SmallVector<Element, N>;
+  std::cout << "SmallVector<" << N << ">:\n";
+  for (int n : { 1, 4, 8, 16, 64 })
+    std::cout << "  n = " << std::setw(2) << n << std::fixed << std::setprecision(1) <<
+      ": Vector " << std::setw(6) << latency<utils::Vector<Element>>(n) << " ns, " << std::setw(6) << bytes_per_vector<utils::Vector<Element>>(n) << " bytes;" <<
+      "  SmallVector " << std::setw(6) << latency<Small>(n) << " ns, " << std::setw(6) << bytes_per_vector<Small>(n) << " bytes" << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  benchmark<4>();
+  benchmark<8>();
+}
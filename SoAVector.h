@@ -0,0 +1,369 @@
+#pragma once
+
+#include "VectorIndex.h"
+#include "debug.h"
+#include <tuple>
+#include <span>
+#include <new>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+// A structure-of-arrays vector.
+//
+// Instead of storing a std::vector of structs, every field (column) is stored in its own
+// contiguous array, so that a loop that only uses one or two fields only pulls those
+// through the cache, and can be vectorized.
+//
+// Usage:
+//
+//   struct Particle;                                           // Only used as index category.
+//   using ParticleIndex = utils::VectorIndex<Particle>;
+//   //                          index          position  velocity  mass
+//   utils::SoAVector<ParticleIndex, Vec3,     Vec3,     float> particles;
+//
+//   particles.push_back(Vec3{0, 0, 0}, Vec3{1, 0, 0}, 1.0f);  // One value per column.
+//
+//   // Whole-row access through a proxy reference.
+//   auto [pos, vel, mass] = particles[index];                  // References to the elements.
+//   particles[index].get<2>() = 2.0f;
+//
+//   // Column spans, for kernels.
+//   std::span<Vec3> positions = particles.column<0>();
+//   std::span<Vec3 const> velocities = particles.column<1>();
+//   for (size_t i = 0; i < positions.size(); ++i)
+//     positions[i] += velocities[i] * dt;
+//
+// All columns always have the same size: push_back, erase etc. apply to every column.
+// Each column is aligned to (at least) a cache line.
+//
+namespace utils {
+
+template<typename Index, typename... Ts>
+class SoAVector;
+
+namespace soa {
+
+template<typename Container, bool is_const>
+class RowReference
+{
+ private:
+  using container_type = std::conditional_t<is_const, Container const, Container>;
+  container_type* m_container;
+  size_t m_index;
+
+ public:
+  RowReference(container_type* container, size_t index) : m_container(container), m_index(index) { }
+
+  template<size_t I>
+  decltype(auto) get() const { return m_container->template column<I>()[m_index]; }
+
+  // Copy the whole row.
+  operator typename Container::value_type() const
+  {
+    return [this]<size_t... Is>(std::index_sequence<Is...>){
+      return typename Container::value_type{get<Is>()...};
+    }(std::make_index_sequence<Container::number_of_columns>{});
+  }
+
+  // Assign the whole row.
+  RowReference const& operator=(typename Container::value_type const& row) const requires (!is_const)
+  {
+    [&, this]<size_t... Is>(std::index_sequence<Is...>){
+      ((get<Is>() = std::get<Is>(row)), ...);
+    }(std::make_index_sequence<Container::number_of_columns>{});
+    return *this;
+  }
+
+  RowReference const& operator=(RowReference<Container, false> const& row) const requires (!is_const)
+  {
+    return operator=(static_cast<typename Container::value_type>(row));
+  }
+
+  RowReference const& operator=(RowReference<Container, true> const& row) const requires (!is_const)
+  {
+    return operator=(static_cast<typename Container::value_type>(row));
+  }
+};
+
+} // namespace soa
+
+template<typename Index, typename... Ts>
+class SoAVector
+{
+  static_assert(sizeof...(Ts) > 0, "A SoAVector needs at least one column.");
+  static_assert((std::is_nothrow_move_constructible_v<Ts> && ...), "The column types of SoAVector must be nothrow move constructible.");
+
+ public:
+  using index_type = Index;
+  using value_type = std::tuple<Ts...>;         // A copy of a row.
+  using reference = soa::RowReference<SoAVector, false>;
+  using const_reference = soa::RowReference<SoAVector, true>;
+  template<size_t I>
+  using column_type = std::tuple_element_t<I, value_type>;
+
+  static constexpr size_t number_of_columns = sizeof...(Ts);
+
+ private:
+  std::tuple<Ts*...> m_columns{};
+  size_t m_size{0};
+  size_t m_capacity{0};
+
+  template<typename T>
+  static constexpr std::align_val_t column_alignment{std::max(alignof(T), size_t{config::cacheline_size_c})};
+
+  template<typename T>
+  static T* allocate_column(size_t capacity)
+  {
+    return static_cast<T*>(::operator new(capacity * sizeof(T), column_alignment<T>));
+  }
+
+  template<typename T>
+  static void deallocate_column(T* column)
+  {
+    if (column)
+      ::operator delete(column, column_alignment<T>);
+  }
+
+  template<typename F>
+  void for_each_column(F&& func)
+  {
+    std::apply([&](auto*&... columns){ (func(columns), ...); }, m_columns);
+  }
+
+  static void deallocate_columns(std::tuple<Ts*...> const& columns)
+  {
+    std::apply([](auto*... column){ (deallocate_column(column), ...); }, columns);
+  }
+
+  // Allocate new columns with room for capacity elements each.
+  static std::tuple<Ts*...> allocate_columns(size_t capacity)
+  {
+    std::tuple<Ts*...> columns{};
+    try
+    {
+      std::apply([capacity]<typename... Us>(Us*&... column){ ((column = allocate_column<Us>(capacity)), ...); }, columns);
+    }
+    catch (...)
+    {
+      deallocate_columns(columns);
+      throw;
+    }
+    return columns;
+  }
+
+  // Destroy the elements [first, last) of the first number_of_columns_to_destroy columns.
+  static void destroy_columns(std::tuple<Ts*...> const& columns, size_t first, size_t last, size_t number_of_columns_to_destroy)
+  {
+    [&]<size_t... Is>(std::index_sequence<Is...>){
+      ((Is < number_of_columns_to_destroy ? std::destroy(std::get<Is>(columns) + first, std::get<Is>(columns) + last) : void()), ...);
+    }(std::index_sequence_for<Ts...>{});
+  }
+
+  // Construct element i of every column from the corresponding argument.
+  // If a constructor throws then the elements that were already constructed are destroyed again.
+  template<typename... Args>
+  static void construct_row(std::tuple<Ts*...> const& columns, size_t i, Args&&... args)
+  {
+    size_t constructed = 0;
+    try
+    {
+      [&]<size_t... Is>(std::index_sequence<Is...>){
+        ((std::construct_at(std::get<Is>(columns) + i, std::forward<Args>(args)), ++constructed), ...);
+      }(std::index_sequence_for<Ts...>{});
+    }
+    catch (...)
+    {
+      destroy_columns(columns, i, i + 1, constructed);
+      throw;
+    }
+  }
+
+  // Move all elements to new_columns, that have room for capacity elements, and release the current columns.
+  void adopt_columns(std::tuple<Ts*...> const& new_columns, size_t capacity) noexcept
+  {
+    [&, this]<size_t... Is>(std::index_sequence<Is...>){
+      (std::uninitialized_move(std::get<Is>(m_columns), std::get<Is>(m_columns) + m_size, std::get<Is>(new_columns)), ...);
+    }(std::index_sequence_for<Ts...>{});
+    destroy_columns(m_columns, 0, m_size, number_of_columns);
+    deallocate_columns(m_columns);
+    m_columns = new_columns;
+    m_capacity = capacity;
+  }
+
+  // Move all elements to new columns with room for capacity elements.
+  void reallocate(size_t capacity)
+  {
+    adopt_columns(allocate_columns(capacity), capacity);
+  }
+
+ public:
+  SoAVector() = default;
+
+  SoAVector(SoAVector const& other)
+  {
+    if (other.m_size == 0)
+      return;
+    m_columns = allocate_columns(other.m_size);
+    m_capacity = other.m_size;
+    size_t copied = 0;          // The number of columns that were copied completely.
+    try
+    {
+      [&, this]<size_t... Is>(std::index_sequence<Is...>){
+        ((std::uninitialized_copy(std::get<Is>(other.m_columns), std::get<Is>(other.m_columns) + other.m_size, std::get<Is>(m_columns)), ++copied), ...);
+      }(std::index_sequence_for<Ts...>{});
+    }
+    catch (...)
+    {
+      // The destructor isn't called when the constructor throws.
+      destroy_columns(m_columns, 0, other.m_size, copied);
+      deallocate_columns(m_columns);
+      throw;
+    }
+    m_size = other.m_size;
+  }
+
+  SoAVector(SoAVector&& other) noexcept :
+    m_columns(std::exchange(other.m_columns, {})), m_size(std::exchange(other.m_size, 0)), m_capacity(std::exchange(other.m_capacity, 0)) { }
+
+  SoAVector& operator=(SoAVector other) noexcept
+  {
+    std::swap(m_columns, other.m_columns);
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+    return *this;
+  }
+
+  ~SoAVector()
+  {
+    clear();
+    deallocate_columns(m_columns);
+  }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  size_t capacity() const { return m_capacity; }
+
+  void reserve(size_t capacity)
+  {
+    if (capacity > m_capacity)
+      reallocate(capacity);
+  }
+
+  void clear()
+  {
+    for_each_column([this](auto*& column){ std::destroy(column, column + m_size); });
+    m_size = 0;
+  }
+
+  // Add a row; one value per column.
+  template<typename... Args>
+  void emplace_back(Args&&... args)
+  {
+    static_assert(sizeof...(Args) == number_of_columns, "emplace_back requires exactly one argument per column.");
+    if (m_size < m_capacity)
+      construct_row(m_columns, m_size, std::forward<Args>(args)...);
+    else
+    {
+      // Construct the new row before the current columns are released: args might refer to elements of this SoAVector.
+      size_t const capacity = m_capacity ? 2 * m_capacity : 8;
+      std::tuple<Ts*...> new_columns = allocate_columns(capacity);
+      try
+      {
+        construct_row(new_columns, m_size, std::forward<Args>(args)...);
+      }
+      catch (...)
+      {
+        deallocate_columns(new_columns);
+        throw;
+      }
+      adopt_columns(new_columns, capacity);
+    }
+    ++m_size;
+  }
+
+  void push_back(Ts... values) { emplace_back(std::move(values)...); }
+  void push_back(value_type row) { std::apply([this](Ts&... values){ emplace_back(std::move(values)...); }, row); }
+
+  void pop_back()
+  {
+    // Calling pop_back on an empty SoAVector.
+    ASSERT(m_size > 0);
+    --m_size;
+    for_each_column([this](auto*& column){ std::destroy_at(column + m_size); });
+  }
+
+  // Add or remove rows at the end; new rows are value-initialized.
+  void resize(size_t size)
+  {
+    while (m_size > size)
+      pop_back();
+    reserve(size);
+    size_t constructed = 0;     // The number of columns that were extended.
+    try
+    {
+      [&, this]<size_t... Is>(std::index_sequence<Is...>){
+        ((std::uninitialized_value_construct(std::get<Is>(m_columns) + m_size, std::get<Is>(m_columns) + size), ++constructed), ...);
+      }(std::index_sequence_for<Ts...>{});
+    }
+    catch (...)
+    {
+      destroy_columns(m_columns, m_size, size, constructed);
+      throw;
+    }
+    m_size = size;
+  }
+
+  // Erase row `index`, moving all rows after it one place down (keeps the order).
+  void erase(index_type index)
+  {
+    size_t const i = static_cast<size_t>(index);
+    ASSERT(i < m_size);
+    for_each_column([this, i](auto*& column){ std::move(column + i + 1, column + m_size, column + i); });
+    pop_back();
+  }
+
+  // Erase row `index` by moving the last row into its place (does not keep the order).
+  void unstable_erase(index_type index)
+  {
+    size_t const i = static_cast<size_t>(index);
+    ASSERT(i < m_size);
+    if (i != m_size - 1)
+      for_each_column([this, i](auto*& column){ column[i] = std::move(column[m_size - 1]); });
+    pop_back();
+  }
+
+  reference operator[](index_type index) { return { this, static_cast<size_t>(index) }; }
+  const_reference operator[](index_type index) const { return { this, static_cast<size_t>(index) }; }
+
+  reference back() { return { this, m_size - 1 }; }
+  const_reference back() const { return { this, m_size - 1 }; }
+
+  // The element of column I at index.
+  template<size_t I>
+  column_type<I>& get(index_type index) { return std::get<I>(m_columns)[static_cast<size_t>(index)]; }
+  template<size_t I>
+  column_type<I> const& get(index_type index) const { return std::get<I>(m_columns)[static_cast<size_t>(index)]; }
+
+  // Column I as a contiguous array of size() elements.
+  template<size_t I>
+  std::span<column_type<I>> column() { return { std::get<I>(m_columns), m_size }; }
+  template<size_t I>
+  std::span<column_type<I> const> column() const { return { std::get<I>(m_columns), m_size }; }
+
+  index_type ibegin() const { return index_type(size_t{0}); }
+  index_type iend() const { return index_type(m_size); }
+};
+
+} // namespace utils
+
+// Support structured bindings on row references.
+template<typename Container, bool is_const>
+struct std::tuple_size<utils::soa::RowReference<Container, is_const>> : std::integral_constant<size_t, Container::number_of_columns> { };
+
+template<size_t I, typename Container, bool is_const>
+struct std::tuple_element<I, utils::soa::RowReference<Container, is_const>>
+{
+  using type = std::conditional_t<is_const, typename Container::template column_type<I> const&, typename Container::template column_type<I>&>;
+};
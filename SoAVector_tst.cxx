@@ -0,0 +1,165 @@
+// Test of the exception safety of SoAVector, and of emplace_back with arguments that refer to the SoAVector itself.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O1 -g -fsanitize=address,undefined -I. SoAVector_tst.cxx
+//
+// and run it; it prints "Success!" or aborts with an error message. Leaked or doubly
+// destroyed elements are detected by counting the live objects; leaked memory and use
+// of freed memory by the address sanitizer.
+
+#include "sys.h"
+#include "utils/SoAVector.h"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "debug.h"
+
+namespace {
+
+int s_live = 0;
+int s_throw_countdown = -1;     // Throw when this reaches zero; -1 means never.
+
+// A column type that counts its instances and can be made to throw from its constructors.
+struct Element
+{
+  int m_value;
+
+  static void may_throw()
+  {
+    if (s_throw_countdown >= 0 && s_throw_countdown-- == 0)
+      throw std::runtime_error("Element");
+  }
+
+  Element(int value = 0) : m_value(value) { may_throw(); ++s_live; }
+  Element(Element const& other) : m_value(other.m_value) { may_throw(); ++s_live; }
+  Element(Element&& other) noexcept : m_value(other.m_value) { ++s_live; }
+  Element& operator=(Element const&) = default;
+  Element& operator=(Element&&) noexcept = default;
+  ~Element() { --s_live; }
+};
+
+struct Category;
+using Index = utils::VectorIndex<Category>;
+using Vector = utils::SoAVector<Index, std::string, Element, Element>;
+
+void check(bool condition, char const* what)
+{
+  if (!condition)
+  {
+    std::cerr << "FAILED: " << what << " (live elements: " << s_live << ")" << std::endl;
+    std::abort();
+  }
+}
+
+void fill(Vector& v, int n)
+{
+  for (int i = 0; i < n; ++i)
+    v.emplace_back(std::to_string(i), i, 2 * i);
+}
+
+void check_contents(Vector const& v, int n, char const* what)
+{
+  check(static_cast<int>(v.size()) == n, what);
+  for (int i = 0; i < n; ++i)
+    check(v.column<0>()[i] == std::to_string(i) && v.column<1>()[i].m_value == i && v.column<2>()[i].m_value == 2 * i, what);
+  check(s_live == 2 * n, what);
+}
+
+// Let the construction of the last column throw, both with and without a reallocation.
+void test_emplace_back_throws()
+{
+  for (int n = 0; n < 20; ++n)
+  {
+    Vector v;
+    fill(v, n);
+    s_throw_countdown = 1;      // The second Element constructor throws.
+    try
+    {
+      v.emplace_back("x", 1, 2);
+      check(false, "test_emplace_back_throws: no exception");
+    }
+    catch (std::runtime_error const&)
+    {
+    }
+    s_throw_countdown = -1;
+    check_contents(v, n, "test_emplace_back_throws");
+    fill(v, 0);
+  }
+  check(s_live == 0, "test_emplace_back_throws: elements leaked");
+}
+
+// Let every possible copy of an element throw.
+void test_copy_throws()
+{
+  Vector v;
+  fill(v, 10);
+  for (int countdown = 0; countdown < 20; ++countdown)
+  {
+    s_throw_countdown = countdown;
+    try
+    {
+      Vector copy(v);
+      check(false, "test_copy_throws: no exception");
+    }
+    catch (std::runtime_error const&)
+    {
+    }
+    s_throw_countdown = -1;
+    check_contents(v, 10, "test_copy_throws");
+  }
+  Vector copy(v);
+  check(s_live == 40, "test_copy_throws: copy");
+}
+
+// Let the value-initialization of new rows throw.
+void test_resize_throws()
+{
+  Vector v;
+  fill(v, 5);
+  for (int countdown = 0; countdown < 40; ++countdown)
+  {
+    s_throw_countdown = countdown;
+    try
+    {
+      v.resize(25);
+      check(false, "test_resize_throws: no exception");
+    }
+    catch (std::runtime_error const&)
+    {
+    }
+    s_throw_countdown = -1;
+    check_contents(v, 5, "test_resize_throws");
+  }
+  v.resize(25);
+  check(s_live == 50, "test_resize_throws: resize");
+}
+
+// Append copies of existing rows; every time the capacity is full the arguments refer to the old columns.
+void test_self_reference()
+{
+  Vector v;
+  v.emplace_back("0", 0, 0);
+  for (int i = 1; i < 100; ++i)
+  {
+    v.emplace_back(v.column<0>()[i - 1], v.column<1>()[i - 1], v.column<2>()[0]);
+    check(v.column<0>()[i] == v.column<0>()[0] && v.column<1>()[i].m_value == 0, "test_self_reference");
+  }
+  check(s_live == 200, "test_self_reference: live elements");
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  test_emplace_back_throws();
+  test_copy_throws();
+  test_resize_throws();
+  test_self_reference();
+  check(s_live == 0, "elements leaked");
+
+  std::cout << "Success!" << std::endl;
+}
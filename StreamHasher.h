@@ -2,7 +2,7 @@
  * ai-utils -- C++ Core utilities
  *
  * @file
- * @brief Definition of class HasherStreamBuf and StreamHasher.
+ * @brief Definition of class BasicHasherStreamBuf and BasicStreamHasher.
  *
  * @Copyright (C) 2019  Carlo Wood.
  *
@@ -35,26 +35,193 @@
 //   utils::RandomStreamBuf random_streambuf(1000, 'A', 'Z');
 //   hasher << &random_streambuf;
 //   ASSERT(hasher.digest() == 0xf373022bdeab5158);
+//
+// The hash engine is pluggable: utils::StreamHasher uses hasher::BoostHashRange,
+// which reproduces the digests of earlier versions (see HasherStreamBuf::size_hash_pairs).
+// utils::FastStreamHasher uses hasher::WyHash, a much faster 64-bit hash in the
+// style of wyhash. Both engines can also be used directly on a span of bytes:
+//
+//   size_t h = utils::hasher::WyHash::hash(std::as_bytes(std::span{data}));
+//
+// which returns the same value as writing the same bytes to a BasicStreamHasher
+// that uses that engine.
+//
+// An engine must provide:
+//
+//   static constexpr size_t buffer_size;                // The size of the put area; must be a multiple of block_size.
+//   static constexpr size_t block_size;                 // consume() is only ever called with a multiple of this many bytes.
+//   static constexpr bool digest_flushes;               // True if digest() folds the tail into the state (the put area is reset).
+//   void consume(char const* data, size_t len);         // Process len bytes; len is a multiple of block_size.
+//   size_t digest(char const* tail, size_t len);        // Return the hash of everything so far, followed by the tail [tail, tail + len).
 
 #include <ostream>
 #include <array>
 #include <algorithm>
 #include <tuple>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <boost/functional/hash.hpp>
 
 namespace utils {
+namespace hasher {
+
+// The original engine: calculates boost::hash_range over every 64 bytes
+// and combines the results with boost::hash_combine.
+class BoostHashRange
+{
+ public:
+  static constexpr size_t buffer_size = 64;     // The resulting hash value is a function of this value!
+  static constexpr size_t block_size = buffer_size;
+  static constexpr bool digest_flushes = true;
+
+ private:
+  size_t m_hash = 0;
+
+ public:
+  void consume(char const* data, size_t len)
+  {
+    for (char const* const end = data + len; data != end; data += block_size)
+      boost::hash_combine(m_hash, boost::hash_range(data, data + block_size));
+  }
+
+  size_t digest(char const* tail, size_t len)
+  {
+    if (len > 0)
+      boost::hash_combine(m_hash, boost::hash_range(tail, tail + len));
+    return m_hash;
+  }
+
+  static size_t hash(std::span<std::byte const> data)
+  {
+    char const* ptr = reinterpret_cast<char const*>(data.data());
+    size_t const bulk = data.size() - data.size() % block_size;
+    BoostHashRange engine;
+    engine.consume(ptr, bulk);
+    return engine.digest(ptr + bulk, data.size() - bulk);
+  }
+};
+
+// A streaming hash in the style of wyhash (https://github.com/wangyi-fudan/wyhash).
+//
+// Bytes are processed 48 at a time in three independent lanes; the remaining bytes
+// and the total length are mixed in by digest(), which does not change the state.
+// The result only depends on the bytes written (not on how they were split over
+// calls), but it is not the same value as the reference wyhash and it depends on
+// the endianness of the machine.
+class WyHash
+{
+ public:
+  static constexpr size_t block_size = 48;
+  static constexpr size_t buffer_size = 8 * block_size;
+  static constexpr bool digest_flushes = false;
+
+ private:
+  static constexpr uint64_t s_secret[4] = { 0x2d358dccaa6c78a5, 0x8bb84b93962eacc9, 0x4b33a62ed433d4a3, 0x4d5a2da51de1aa47 };
+
+  uint64_t m_seed;
+  uint64_t m_see1;
+  uint64_t m_see2;
+  uint64_t m_length = 0;
+
+  static uint64_t mix(uint64_t a, uint64_t b)
+  {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+  }
+
+  static uint64_t read8(char const* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+  static uint64_t read4(char const* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+  static uint64_t read3(char const* p, size_t len)
+  {
+    return (static_cast<uint64_t>(static_cast<unsigned char>(p[0])) << 16) |
+           (static_cast<uint64_t>(static_cast<unsigned char>(p[len >> 1])) << 8) |
+            static_cast<uint64_t>(static_cast<unsigned char>(p[len - 1]));
+  }
+
+ public:
+  WyHash(uint64_t seed = 0) : m_seed(seed ^ mix(seed ^ s_secret[0], s_secret[1])), m_see1(m_seed), m_see2(m_seed) { }
+
+  void consume(char const* data, size_t len)
+  {
+    m_length += len;
+    uint64_t seed = m_seed, see1 = m_see1, see2 = m_see2;
+    for (char const* const end = data + len; data != end; data += block_size)
+    {
+      seed = mix(read8(data) ^ s_secret[1], read8(data + 8) ^ seed);
+      see1 = mix(read8(data + 16) ^ s_secret[2], read8(data + 24) ^ see1);
+      see2 = mix(read8(data + 32) ^ s_secret[3], read8(data + 40) ^ see2);
+    }
+    m_seed = seed;
+    m_see1 = see1;
+    m_see2 = see2;
+  }
 
-class HasherStreamBuf : public std::streambuf
+  size_t digest(char const* tail, size_t len) const
+  {
+    // The put area may contain whole blocks that weren't consumed yet.
+    size_t const bulk = len - len % block_size;
+    if (bulk > 0)
+    {
+      WyHash copy(*this);
+      copy.consume(tail, bulk);
+      return copy.digest(tail + bulk, len - bulk);
+    }
+    uint64_t seed = m_seed ^ m_see1 ^ m_see2;
+    uint64_t const total_length = m_length + len;
+    while (len > 16)
+    {
+      seed = mix(read8(tail) ^ s_secret[1], read8(tail + 8) ^ seed);
+      tail += 16;
+      len -= 16;
+    }
+    uint64_t a = 0, b = 0;
+    if (len >= 8)
+    {
+      a = read8(tail);
+      b = read8(tail + len - 8);
+    }
+    else if (len >= 4)
+    {
+      a = read4(tail);
+      b = read4(tail + len - 4);
+    }
+    else if (len > 0)
+      a = read3(tail, len);
+    a ^= s_secret[1];
+    b ^= seed;
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+    return mix(a ^ s_secret[0] ^ total_length, b ^ s_secret[1]);
+  }
+
+  static size_t hash(std::span<std::byte const> data, uint64_t seed = 0)
+  {
+    char const* ptr = reinterpret_cast<char const*>(data.data());
+    size_t const bulk = data.size() - data.size() % block_size;
+    WyHash engine(seed);
+    engine.consume(ptr, bulk);
+    return engine.digest(ptr + bulk, data.size() - bulk);
+  }
+};
+
+} // namespace hasher
+
+template<typename Engine>
+class BasicHasherStreamBuf : public std::streambuf
 {
+  static_assert(Engine::buffer_size % Engine::block_size == 0, "Engine::buffer_size must be a multiple of Engine::block_size.");
+
  private:
-  size_t m_hash;
-  std::array<char, 64> m_buf;   // The resulting hash value is a function of the size of this array!
+  Engine m_engine;
+  std::array<char, Engine::buffer_size> m_buf;
   static constexpr size_t bufsize = std::tuple_size_v<decltype(m_buf)>;
 
-  void add_and_reset_put_area()
+  void consume_put_area()
   {
-    if (pptr() > pbase())
-      boost::hash_combine(m_hash, boost::hash_range(pbase(), pptr()));
+    m_engine.consume(pbase(), bufsize);
     setp(&m_buf[0], &m_buf[bufsize]);
   }
 
@@ -64,20 +231,48 @@ class HasherStreamBuf : public std::streambuf
     if (c != EOF)
     {
       if (pptr() == epptr())
-        add_and_reset_put_area();
+        consume_put_area();
       *pptr() = c;
       pbump(1);
     }
     return 0;
   }
 
+  // Hash whole spans at once, without copying them into the put area when possible.
+  // The engine always sees the same sequence of blocks as when the characters were
+  // written one by one, so the result does not depend on how the output was split up.
+  std::streamsize xsputn(char const* s, std::streamsize n) override
+  {
+    std::streamsize const total = n;
+    size_t len = std::min(static_cast<size_t>(n), static_cast<size_t>(epptr() - pptr()));
+    std::memcpy(pptr(), s, len);
+    pbump(len);
+    s += len;
+    n -= len;
+    if (n == 0)
+      return total;
+    // The put area is full.
+    consume_put_area();
+    // Feed whole blocks directly from s.
+    size_t const bulk = n - n % Engine::block_size;
+    m_engine.consume(s, bulk);
+    s += bulk;
+    n -= bulk;
+    // Store the remainder (less than one block) in the put area.
+    std::memcpy(pptr(), s, n);
+    pbump(n);
+    return total;
+  }
+
  public:
-  HasherStreamBuf() : m_hash(0) { setp(&m_buf[0], &m_buf[bufsize]); }
+  BasicHasherStreamBuf() { setp(&m_buf[0], &m_buf[bufsize]); }
 
   size_t hash()
   {
-    add_and_reset_put_area();
-    return m_hash;
+    size_t result = m_engine.digest(pbase(), pptr() - pbase());
+    if constexpr (Engine::digest_flushes)
+      setp(&m_buf[0], &m_buf[bufsize]);
+    return result;
   }
 
   struct size_hash_pair_t {
@@ -85,7 +280,7 @@ class HasherStreamBuf : public std::streambuf
     size_t hash;
   };
 
-  // For streams with characters in the range ['A', 'Z'].
+  // For streams with characters in the range ['A', 'Z'], using hasher::BoostHashRange.
   static constexpr std::array<size_hash_pair_t, 9> size_hash_pairs = {{
     { 1, 0xaedc04cfa2e5b999 },
     { 10, 0xa32fa7216c0d9b4b },
@@ -99,16 +294,26 @@ class HasherStreamBuf : public std::streambuf
   }};
 };
 
-class StreamHasher : public std::ostream
+using HasherStreamBuf = BasicHasherStreamBuf<hasher::BoostHashRange>;
+using FastHasherStreamBuf = BasicHasherStreamBuf<hasher::WyHash>;
+
+template<typename Engine>
+class BasicStreamHasher : public std::ostream
 {
  private:
-  HasherStreamBuf m_streambuf;
+  BasicHasherStreamBuf<Engine> m_streambuf;
 
  public:
-  StreamHasher() { rdbuf(&m_streambuf); }
-  ~StreamHasher() { }
+  BasicStreamHasher() { rdbuf(&m_streambuf); }
+  ~BasicStreamHasher() { }
 
   size_t digest() { return m_streambuf.hash(); }
+
+  // Calculate the same digest directly from a span of bytes.
+  static size_t hash(std::span<std::byte const> data) { return Engine::hash(data); }
 };
 
+using StreamHasher = BasicStreamHasher<hasher::BoostHashRange>;
+using FastStreamHasher = BasicStreamHasher<hasher::WyHash>;
+
 } // namespace utils
@@ -2,9 +2,33 @@
 
 #include "concat_array.h"
 #include <algorithm>
+#include <string_view>
+#include <cstdint>
 #include <cassert>
 
 namespace utils {
+namespace template_string_literal {
+
+// 64-bit FNV-1a with a final avalanche step.
+//
+// This is the hash returned by TemplateStringLiteral::hash(); it is constexpr so that
+// it can be computed at compile time, but it is also used at runtime (InternedString::lookup)
+// and therefore must give the same result for the same string in both cases.
+constexpr uint64_t hash(std::string_view str)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (char c : str)
+  {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+} // namespace template_string_literal
 
 // A type that can be used to pass a string literal as template parameter.
 //
@@ -53,6 +77,9 @@ struct TemplateStringLiteral
 
   // A TemplateStringLiteral must always be zero terminated. But when converting to a string_view we do not include that zero.
   constexpr operator std::string_view() const { return { chars.begin(), N - 1 }; }
+
+  // A 64-bit hash of the string (excluding the terminating zero), usable at compile time.
+  constexpr uint64_t hash() const { return template_string_literal::hash(*this); }
 };
 
 template<TemplateStringLiteral S1, TemplateStringLiteral S2>
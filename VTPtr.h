@@ -27,6 +27,13 @@
 
 #pragma once
 
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
 // Usage:
 //
 // If a class is not derived (from a class that has also a VTPtr):
@@ -113,6 +120,101 @@ class D : public B
 };
 #endif // USAGE_EXAMPLE2
 
+// Instead of writing VT_type, the VT_B macro and the hooks by hand, they can be
+// generated from an interface list: a macro that applies its argument X to
+// every virtual function as X(return_type, name, parameter types...).
+//
+// The following is equivalent to USAGE_EXAMPLE1 and USAGE_EXAMPLE2:
+//
+#ifdef USAGE_EXAMPLE3
+#include "utils/VTPtr.h"
+
+#define B_INTERFACE(X) \
+  X(void, x, int) \
+  X(void, of, int) \
+  X(void, y, int)
+
+class B
+{
+ public:
+  struct VT_type
+  {
+    VT_ENTRIES(B, B_INTERFACE)                                                       // void (*_x)(B*, int); etc.
+
+    #define VT_B { VT_INITIALIZER(B_INTERFACE) }                                     // { x, of, y, }
+  };
+
+  struct VT_impl
+  {
+    static void x(B* self, int a) { ... }
+    static void of(B* self, int a) { ... }
+    static void y(B* self, int a) { ... }
+
+    static constexpr VT_type VT VT_B;
+  };
+
+  virtual VT_type* clone_VT() { return VT_ptr.clone(this); }
+  utils::VTPtr<B> VT_ptr;
+
+  B() : VT_ptr(this) { }
+
+ protected:
+  VT_HOOKS(B_INTERFACE)                                                              // void x(int a) { VT_ptr->_x(this, a); } etc.
+};
+
+#define D_INTERFACE(X) \
+  X(void, pv, int) \
+  X(int, vf, int)
+
+class D : public B
+{
+ public:
+  struct VT_type : B::VT_type
+  {
+    VT_ENTRIES(D, D_INTERFACE)
+
+    #define VT_D { VT_B, VT_INITIALIZER(D_INTERFACE) }
+  };
+  ...                                                                                // The rest is the same as in USAGE_EXAMPLE2,
+ protected:
+  VT_HOOKS(D_INTERFACE)                                                              // except for the hooks.
+};
+#endif // USAGE_EXAMPLE3
+
+// Batched dispatch.
+//
+// Objects that are of the same type (and didn't clone their virtual table) have the same
+// VT_ptr. A loop over many objects can therefore load a function pointer once per run of
+// objects with the same VT_ptr, instead of once per object:
+//
+//   std::vector<B*> objects;
+//   utils::group_by_VT(objects);                                 // Optional: make the runs as long as possible.
+//   utils::dispatch_VT(objects, &B::VT_type::_x, 42);              // Calls VT_ptr->_x(object, 42) for every object.
+//
+// or, if the virtual table has functions that process a whole run at once,
+//
+//   utils::for_each_VT_run(objects, [](B::VT_type const* vt, std::span<B* const> run){ vt->_update_run(run); });
+//
+// Note that group_by_VT orders the objects by the address of their virtual table, which
+// is not the same for every run of the program.
+
+// Helper macros for USAGE_EXAMPLE3.
+#define VT_DETAIL_ENTRY(R, name, ...) R (*_##name)(VT_self* __VA_OPT__(,) __VA_ARGS__);
+#define VT_DETAIL_INITIALIZER(R, name, ...) name,
+#define VT_DETAIL_HOOK(R, name, ...) \
+  template<typename... Args> R name(Args&&... args) { return VT_ptr->_##name(this, std::forward<Args>(args)...); }
+
+// Declare the function pointers of INTERFACE, taking a Self* as first argument, in a VT_type.
+#define VT_ENTRIES(Self, INTERFACE) \
+  using VT_self = Self; \
+  INTERFACE(VT_DETAIL_ENTRY)
+
+// The (comma separated) names of the functions of INTERFACE, to initialize a VT_type with.
+#define VT_INITIALIZER(INTERFACE) INTERFACE(VT_DETAIL_INITIALIZER)
+
+// Define the hooks (member functions that call the function in the virtual table) of INTERFACE.
+#define VT_HOOKS(INTERFACE) INTERFACE(VT_DETAIL_HOOK)
+
 namespace utils {
 
 template<typename T>
@@ -132,6 +234,7 @@ struct VTPtrBase
 
   VT_type const* VT_ptr = &VT_impl::VT;                 // Virtual Table pointer.
   VT_type const* operator->() { return VT_ptr; }
+  VT_type const* get() const { return VT_ptr; }
 
   VTPtrBase(VT_type const* vt_ptr) : VT_ptr(vt_ptr) { }
 
@@ -188,4 +291,61 @@ struct VTPtr<Self, void, void> : VTPtrBase<Self>
   }
 };
 
+// Call func(vt, run) for every run of consecutive objects that have the same virtual table vt.
+template<typename T, typename F>
+void for_each_VT_run(std::span<T* const> objects, F&& func)
+{
+  size_t begin = 0;
+  while (begin < objects.size())
+  {
+    auto const* vt = objects[begin]->VT_ptr.get();
+    size_t end = begin + 1;
+    while (end < objects.size() && objects[end]->VT_ptr.get() == vt)
+      ++end;
+    func(vt, objects.subspan(begin, end - begin));
+    begin = end;
+  }
+}
+
+template<typename T, typename F>
+void for_each_VT_run(std::vector<T*> const& objects, F&& func)
+{
+  for_each_VT_run(std::span<T* const>{objects}, std::forward<F>(func));
+}
+
+// Call (object->VT_ptr->*entry)(object, args...) for every object, loading the function pointer once per run.
+// T is only deduced from objects: entry may be a function that the virtual table of T inherits from
+// the virtual table of a base class Base of T (for example, &D::VT_type::_x, which takes a B*).
+template<typename T, typename VT, typename R, typename Base, typename... Params, typename... Args>
+requires std::is_base_of_v<Base, T>
+void dispatch_VT(std::span<T* const> objects, R (*VT::*entry)(Base*, Params...), Args const&... args)
+{
+  for_each_VT_run(objects, [&](auto const* vt, std::span<T* const> run){
+    R (*func)(Base*, Params...) = vt->*entry;
+    for (T* object : run)
+      func(object, args...);
+  });
+}
+
+template<typename T, typename VT, typename R, typename Base, typename... Params, typename... Args>
+requires std::is_base_of_v<Base, T>
+void dispatch_VT(std::vector<T*> const& objects, R (*VT::*entry)(Base*, Params...), Args const&... args)
+{
+  dispatch_VT(std::span<T* const>{objects}, entry, args...);
+}
+
+// Reorder objects so that all objects with the same virtual table are adjacent. The order of such objects is not changed.
+template<typename T>
+void group_by_VT(std::span<T*> objects)
+{
+  std::stable_sort(objects.begin(), objects.end(),
+      [](T* object1, T* object2){ return std::less<>{}(object1->VT_ptr.get(), object2->VT_ptr.get()); });
+}
+
+template<typename T>
+void group_by_VT(std::vector<T*>& objects)
+{
+  group_by_VT(std::span<T*>{objects});
+}
+
 } // namespace utils
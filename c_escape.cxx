@@ -0,0 +1,138 @@
+#include "sys.h"
+#include "c_escape.h"
+#include "ctz.h"
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace utils {
+
+namespace {
+
+// Return true if c must be escaped (see c_escape_iterator<>::prepare_escape_buf).
+inline bool needs_escape(char c)
+{
+  return !(c > 31 && c != 92 && c != 127);
+}
+
+// Return a pointer to the first character in [begin, end) that must be escaped, or end.
+char const* find_escape(char const* begin, char const* end)
+{
+  // The vectorized versions use a signed compare; c > 31 is also false for characters >= 128 when char is signed.
+  if constexpr (std::is_signed_v<char>)
+  {
+#if defined(__AVX2__)
+    __m256i const space = _mm256_set1_epi8(32);
+    __m256i const backslash = _mm256_set1_epi8(92);
+    __m256i const del = _mm256_set1_epi8(127);
+    while (end - begin >= 32)
+    {
+      __m256i chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin));
+      __m256i escape = _mm256_or_si256(_mm256_cmpgt_epi8(space, chunk),
+          _mm256_or_si256(_mm256_cmpeq_epi8(chunk, backslash), _mm256_cmpeq_epi8(chunk, del)));
+      if (unsigned int mask = _mm256_movemask_epi8(escape))
+        return begin + utils::ctz(mask);
+      begin += 32;
+    }
+#elif defined(__SSE2__)
+    __m128i const space = _mm_set1_epi8(32);
+    __m128i const backslash = _mm_set1_epi8(92);
+    __m128i const del = _mm_set1_epi8(127);
+    while (end - begin >= 16)
+    {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin));
+      __m128i escape = _mm_or_si128(_mm_cmplt_epi8(chunk, space),
+          _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), _mm_cmpeq_epi8(chunk, del)));
+      if (unsigned int mask = _mm_movemask_epi8(escape))
+        return begin + utils::ctz(mask);
+      begin += 16;
+    }
+#endif
+  }
+  while (begin != end && !needs_escape(*begin))
+    ++begin;
+  return begin;
+}
+
+// Write the escape sequence of c to out and return the new end.
+char* write_escape(char* out, char c)
+{
+  *out++ = '\\';
+  if (c > 6 && c < 14)
+  {
+    static char const* c2s_tab = "abtnvfr";
+    *out++ = c2s_tab[c - 7];
+  }
+  else if (c == 27)
+    *out++ = 'e';
+  else if (c == '\\')
+    *out++ = '\\';
+  else
+  {
+    static char const* hex_tab = "0123456789ABCDEF";
+    unsigned char xval = c;
+    *out++ = 'x';
+    *out++ = hex_tab[xval / 16];
+    *out++ = hex_tab[xval % 16];
+  }
+  return out;
+}
+
+} // namespace
+
+size_t c_escape(char* out, std::string_view data)
+{
+  char* p = out;
+  char const* in = data.data();
+  char const* const end = in + data.size();
+  for (;;)
+  {
+    // Copy clean runs wholesale.
+    char const* escape = find_escape(in, end);
+    std::memcpy(p, in, escape - in);
+    p += escape - in;
+    if (escape == end)
+      break;
+    p = write_escape(p, *escape);
+    in = escape + 1;
+  }
+  return p - out;
+}
+
+void c_escape(std::string& out, std::string_view data)
+{
+  char const* in = data.data();
+  char const* const end = in + data.size();
+  out.reserve(out.size() + data.size());
+  for (;;)
+  {
+    char const* escape = find_escape(in, end);
+    out.append(in, escape - in);
+    if (escape == end)
+      break;
+    char buf[c_escape_max_expansion];
+    out.append(buf, write_escape(buf, *escape) - buf);
+    in = escape + 1;
+  }
+}
+
+void c_escape(std::ostream& os, std::string_view data)
+{
+  char const* in = data.data();
+  char const* const end = in + data.size();
+  for (;;)
+  {
+    char const* escape = find_escape(in, end);
+    os.write(in, escape - in);
+    if (escape == end)
+      break;
+    char buf[c_escape_max_expansion];
+    os.write(buf, write_escape(buf, *escape) - buf);
+    in = escape + 1;
+  }
+}
+
+} // namespace utils
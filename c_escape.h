@@ -2,16 +2,36 @@
 
 #include "c_escape_iterator.h"
 #include <string_view>
+#include <string>
 #include <algorithm>
 #include <iostream>
+#include <type_traits>
 
 namespace utils {
 
+// The maximum number of characters that c_escape writes per input character.
+static constexpr size_t c_escape_max_expansion = 4;
+
+// Write the escaped data to out, which must have room for at least c_escape_max_expansion * data.size() characters.
+// Returns the number of characters written. The output is the same as that of c_escape_iterator.
+size_t c_escape(char* out, std::string_view data);
+
+// Append the escaped data to out.
+void c_escape(std::string& out, std::string_view data);
+
+// Write the escaped data to os.
+void c_escape(std::ostream& os, std::string_view data);
+
 template<typename T>
 void c_escape(std::ostream& os, T const& data)
 {
-  using it_escaped_t = c_escape_iterator<typename T::const_iterator>;
-  std::copy(it_escaped_t(data.begin(), data.end()), it_escaped_t(data.end()), std::ostreambuf_iterator<char>(os));
+  if constexpr (std::is_convertible_v<T const&, std::string_view>)
+    c_escape(os, std::string_view{data});
+  else
+  {
+    using it_escaped_t = c_escape_iterator<typename T::const_iterator>;
+    std::copy(it_escaped_t(data.begin(), data.end()), it_escaped_t(data.end()), std::ostreambuf_iterator<char>(os));
+  }
 }
 
 } // namespace utils
@@ -39,7 +39,7 @@ class c_escape_iterator : public boost::iterator_adaptor<
   {
     if (*m_escape_buf)
     {
-      if (m_escape_buf[++*m_escape_buf])
+      if (m_escape_buf[static_cast<unsigned char>(++*m_escape_buf)])
         return;
       *m_escape_buf = 0;
     }
@@ -51,7 +51,7 @@ class c_escape_iterator : public boost::iterator_adaptor<
   typename c_escape_iterator::reference dereference() const
   {
     if (*m_escape_buf)
-      return m_escape_buf[*m_escape_buf];
+      return m_escape_buf[static_cast<unsigned char>(*m_escape_buf)];
     return *this->base_reference();
   }
 };
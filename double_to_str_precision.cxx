@@ -27,20 +27,59 @@
 
 #include "double_to_str_precision.h"
 
-#include <sstream>
-#include <iomanip>
+#include <array>
+#include <algorithm>
+#include <cstring>
+
+std::to_chars_result double_to_str_precision(char* first, char* last, double d, int min, int max)
+{
+  std::to_chars_result result = std::to_chars(first, last, d, std::chars_format::fixed, max);
+  if (result.ec != std::errc{})
+    return result;
+  char const* dot = static_cast<char const*>(std::memchr(first, '.', result.ptr - first));
+  if (dot)
+  {
+    // Find the last non-zero digit.
+    char const* pos = result.ptr;
+    while (pos != first && (*--pos < '1' || *pos > '9'))
+      ;
+    bool found = *pos >= '1' && *pos <= '9';
+    int precision = std::max(min, found ? static_cast<int>(pos - dot) : 0);
+    char* end = const_cast<char*>(dot) + ((precision > 0) ? 1 + precision : 0);
+    result.ptr = std::min(end, result.ptr);
+  }
+  return result;
+}
+
+std::to_chars_result double_to_str_precision(char* first, char* last, std::span<double const> values, int min, int max, char separator)
+{
+  std::to_chars_result result{first, std::errc{}};
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    if (i > 0)
+    {
+      if (result.ptr == last)
+        return {last, std::errc::value_too_large};
+      *result.ptr++ = separator;
+    }
+    result = double_to_str_precision(result.ptr, last, values[i], min, max);
+    if (result.ec != std::errc{})
+      break;
+  }
+  return result;
+}
 
 std::string double_to_str_precision(double d, int min, int max)
 {
-  std::ostringstream oss;
-  oss << std::fixed << std::setprecision(max) << d;
-  std::string str = oss.str();
-  int dot = str.find_first_of(".");
-  int pos = str.find_last_of("123456789");
-  if (dot != (int)std::string::npos)
+  // The largest double has 309 digits before the dot.
+  std::array<char, 512> buf;
+  if (max < static_cast<int>(buf.size()) - 320)
   {
-    int precision = std::max(min, (pos != (int)std::string::npos) ? pos - dot : 0);
-    str = str.substr(0, dot + ((precision > 0) ? 1 + precision : 0));
+    auto result = double_to_str_precision(buf.data(), buf.data() + buf.size(), d, min, max);
+    return { buf.data(), result.ptr };
   }
+  std::string str(max + 320, '\0');
+  auto result = double_to_str_precision(str.data(), str.data() + str.size(), d, min, max);
+  str.resize(result.ptr - str.data());
   return str;
 }
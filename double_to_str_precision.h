@@ -28,6 +28,17 @@
 #pragma once
 
 #include <string>
+#include <charconv>
+#include <span>
 
 /// Convert a double to a string with a minimal and maximal precision.
 std::string double_to_str_precision(double d, int min, int max);
+
+/// Write d to [first, last) with a minimal and maximal precision, without allocating memory.
+/// The result is the same as double_to_str_precision(d, min, max) (but not zero terminated).
+/// Returns {end, std::errc{}} on success, or {last, std::errc::value_too_large} if the buffer is too small.
+std::to_chars_result double_to_str_precision(char* first, char* last, double d, int min, int max);
+
+/// Write all values to [first, last), separated by separator.
+/// Returns {end, std::errc{}} on success, or {last, std::errc::value_too_large} if the buffer is too small.
+std::to_chars_result double_to_str_precision(char* first, char* last, std::span<double const> values, int min, int max, char separator = ' ');
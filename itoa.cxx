@@ -27,18 +27,72 @@
 
 #include "sys.h"
 #include "itoa.h"
+#include "ctz.h"
+#include "macros.h"
+#include "is_power_of_two.h"
+#include <cstring>
 
 namespace utils {
 
+namespace {
+
+constexpr char digit[36] = {
+  '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+  'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j',
+  'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't',
+  'u', 'v', 'w', 'x', 'y', 'z' };
+
+// The decimal representation of 00 through 99.
+constexpr std::array<char, 200> digit_pairs = [](){
+  std::array<char, 200> result{};
+  for (int i = 0; i < 100; ++i)
+  {
+    result[2 * i] = '0' + i / 10;
+    result[2 * i + 1] = '0' + i % 10;
+  }
+  return result;
+}();
+
+} // namespace
+
 char* backwards_itoa_unsigned(char* p, unsigned long n, unsigned int base)
 {
-  static char const digit[36] = {
-    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
-    'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j',
-    'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't',
-    'u', 'v', 'w', 'x', 'y', 'z' };
-
   *p = 0;
+
+  // Base 10: write two digits per division.
+  if (AI_LIKELY(base == 10))
+  {
+    while (n >= 100)
+    {
+      unsigned int i = n % 100;
+      n /= 100;
+      p -= 2;
+      std::memcpy(p, &digit_pairs[2 * i], 2);
+    }
+    if (n >= 10)
+    {
+      p -= 2;
+      std::memcpy(p, &digit_pairs[2 * n], 2);
+    }
+    else
+      *--p = '0' + n;
+    return p;
+  }
+
+  // Base 2, 4, 8, 16 and 32: use shifts and masks.
+  if (is_power_of_two(base))
+  {
+    int const shift = utils::ctz(base);
+    unsigned long const mask = base - 1;
+    do
+    {
+      *--p = digit[n & mask];
+      n >>= shift;
+    }
+    while (n > 0);
+    return p;
+  }
+
   do
   {
     *--p = digit[n % base];
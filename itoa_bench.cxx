@@ -0,0 +1,95 @@
+// Benchmark of backwards_itoa_unsigned versus std::to_chars and the previous implementation
+// (one division per digit for every base).
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -DNDEBUG -I. itoa_bench.cxx utils/itoa.cxx
+//
+// It converts random 64-bit values with a random number of significant bits (so that all
+// lengths occur equally often) in base 10, 16 and 7, after checking that all three agree.
+
+#include "sys.h"
+#include "utils/itoa.h"
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+// The previous implementation of utils::backwards_itoa_unsigned.
+[[gnu::noinline]] char* old_backwards_itoa_unsigned(char* p, unsigned long n, unsigned int base)
+{
+  static char const digit[36] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+    'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j',
+    'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't',
+    'u', 'v', 'w', 'x', 'y', 'z' };
+
+  *p = 0;
+  do
+  {
+    *--p = digit[n % base];
+    n /= base;
+  }
+  while (n > 0);
+  return p;
+}
+
+using clock_type = std::chrono::steady_clock;
+
+size_t volatile s_sink;
+
+template<typename Convert>
+double nanoseconds_per_value(std::vector<unsigned long> const& values, unsigned int base, Convert convert)
+{
+  constexpr int rounds = 20;
+  size_t length = 0;
+  char buf[80];
+  auto const start = clock_type::now();
+  for (int r = 0; r < rounds; ++r)
+    for (unsigned long n : values)
+      length += convert(buf, n, base);
+  s_sink = length;
+  return std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / (rounds * values.size());
+}
+
+// The conversions return the length of the result.
+size_t new_itoa(char* buf, unsigned long n, unsigned int base) { return buf + 79 - utils::backwards_itoa_unsigned(buf + 79, n, base); }
+size_t old_itoa(char* buf, unsigned long n, unsigned int base) { return buf + 79 - old_backwards_itoa_unsigned(buf + 79, n, base); }
+size_t to_chars(char* buf, unsigned long n, unsigned int base) { return std::to_chars(buf, buf + 80, n, base).ptr - buf; }
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  std::mt19937_64 generator(4);
+  std::vector<unsigned long> values(1000000);
+  for (unsigned long& n : values)
+    n = generator() >> (generator() % 64);
+
+  for (unsigned int base : { 10, 16, 7 })
+  {
+    for (unsigned long n : values)
+    {
+      char buf[80], old_buf[80], ref[80];
+      *std::to_chars(ref, ref + 80, n, base).ptr = 0;
+      if (std::strcmp(utils::backwards_itoa_unsigned(buf + 79, n, base), ref) || std::strcmp(old_backwards_itoa_unsigned(old_buf + 79, n, base), ref))
+      {
+        std::cerr << "FAILED: wrong conversion of " << n << " in base " << base << std::endl;
+        std::abort();
+      }
+    }
+    std::cout << "base " << std::setw(2) << base << std::fixed << std::setprecision(2) <<
+      ": backwards_itoa_unsigned " << nanoseconds_per_value(values, base, new_itoa) <<
+      " ns, previous " << nanoseconds_per_value(values, base, old_itoa) <<
+      " ns, std::to_chars " << nanoseconds_per_value(values, base, to_chars) << " ns" << std::endl;
+  }
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "debug.h"
+#include <vector>
+#include <span>
+#include <thread>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+
+// Merge k sorted sequences.
+//
+// This is the generalization of three_way_merge to any number of sorted sequences
+// (for example, many shards) without a base: every key that occurs in at least one
+// input sequence is written to the output exactly once.
+//
+// If a key occurs in more than one input sequence, then the elements with that key
+// are compared with payload_equal; if they are all equal then just one of them is
+// written to the output, otherwise the PayloadMerger is called with (iterators to)
+// all of them, in the order of the input sequences, and the output iterator:
+//
+//   payload_merger(std::span<ForwardIterator const> equal_keys, OutputIterator& result);
+//
+// which should write the merged element(s) to result (and increment it).
+//
+// The input sequences are passed as a range of std::pair<ForwardIterator, ForwardIterator>
+// (begin, end); each sequence must be sorted according to comp and should not itself
+// contain equivalent keys. The iterators must be forward iterators, because the iterators
+// passed to payload_merger are still dereferenced after their sequence was advanced.
+//
+// Usage:
+//
+//   std::vector<std::pair<Iter, Iter>> shards = ...;
+//   utils::k_way_merge(shards, std::back_inserter(output), merger, comp, payload_equal);
+//
+//   // Merge disjoint slices of the output in parallel, using 8 threads.
+//   utils::k_way_merge_parallel(shards, std::back_inserter(output), 8, merger, comp, payload_equal);
+//
+// The smallest element is found with a loser tree (tournament tree), which costs
+// log2(k) comparisons per output element.
+//
+namespace utils {
+namespace detail {
+
+template<typename ForwardIterator, typename Compare>
+class LoserTree
+{
+ private:
+  // A player of the tournament: the current position in sequence m_sequence.
+  // The position of a loser doesn't change while it is stored in the tree, so it is stored here
+  // (instead of just the index of the sequence) to avoid an extra indirection.
+  struct Player
+  {
+    ForwardIterator m_pos;
+    int m_sequence;
+    bool m_exhausted;
+  };
+
+  std::vector<Player> m_tree;                   // m_tree[0] is the winner, m_tree[1..k-1] the loser at each internal node.
+  std::vector<ForwardIterator> m_ends;          // The end of each sequence.
+  Compare& m_comp;
+
+  // Return true if p1 must go before p2. Exhausted sequences go last and the sequence with the smallest index wins ties.
+  bool before(Player const& p1, Player const& p2) const
+  {
+    return !p1.m_exhausted &&
+      (p2.m_exhausted || (p1.m_sequence < p2.m_sequence ? !m_comp(*p2.m_pos, *p1.m_pos) : m_comp(*p1.m_pos, *p2.m_pos)));
+  }
+
+ public:
+  template<typename Sequences>
+  LoserTree(Sequences const& sequences, Compare& comp) : m_comp(comp)
+  {
+    int const k = std::distance(std::begin(sequences), std::end(sequences));
+    // The leaves are at k..2k-1; play all matches bottom-up.
+    std::vector<Player> winners(2 * k);
+    m_ends.reserve(k);
+    int s = 0;
+    for (auto const& sequence : sequences)
+    {
+      winners[k + s] = { sequence.first, s, sequence.first == sequence.second };
+      m_ends.push_back(sequence.second);
+      ++s;
+    }
+    m_tree.resize(std::max(k, 1));
+    for (int node = k - 1; node > 0; --node)
+    {
+      bool first_wins = before(winners[2 * node], winners[2 * node + 1]);
+      winners[node] = winners[2 * node + !first_wins];
+      m_tree[node] = winners[2 * node + first_wins];
+    }
+    if (k > 0)
+      m_tree[0] = winners[1];
+    else
+      m_tree[0].m_exhausted = true;
+  }
+
+  bool empty() const { return m_tree[0].m_exhausted; }
+  ForwardIterator top() const { return m_tree[0].m_pos; }
+
+  // Advance the winning sequence and replay the matches on the path from its leaf to the root.
+  void pop()
+  {
+    Player winner = m_tree[0];
+    ++winner.m_pos;
+    winner.m_exhausted = winner.m_pos == m_ends[winner.m_sequence];
+    for (int node = (winner.m_sequence + m_ends.size()) / 2; node > 0; node /= 2)
+      if (before(m_tree[node], winner))
+        std::swap(m_tree[node], winner);
+    m_tree[0] = winner;
+  }
+};
+
+} // namespace detail
+
+template<typename Sequences, typename OutputIterator, typename PayloadMerger, typename Compare, typename PayloadEqual>
+OutputIterator k_way_merge(Sequences const& sequences, OutputIterator result, PayloadMerger payload_merger, Compare comp, PayloadEqual payload_equal)
+{
+  using ForwardIterator = decltype(std::begin(sequences)->first);
+  static_assert(std::forward_iterator<ForwardIterator>, "k_way_merge requires forward iterators.");
+
+  detail::LoserTree<ForwardIterator, Compare> tree(sequences, comp);
+  std::vector<ForwardIterator> equal_keys;      // The elements of all sequences with the current smallest key.
+  equal_keys.reserve(std::distance(std::begin(sequences), std::end(sequences)));
+
+  while (!tree.empty())
+  {
+    ForwardIterator smallest = tree.top();
+    tree.pop();
+    // Collect all elements that are equivalent to the smallest one.
+    equal_keys.clear();
+    equal_keys.push_back(smallest);
+    while (!tree.empty() && !comp(*smallest, *tree.top()))
+    {
+      equal_keys.push_back(tree.top());
+      tree.pop();
+    }
+    // If all payloads are equal then just use one of them.
+    if (equal_keys.size() == 1 ||
+        std::all_of(equal_keys.begin() + 1, equal_keys.end(), [&](ForwardIterator const& element){ return payload_equal(*smallest, *element); }))
+    {
+      *result = *smallest;
+      ++result;
+    }
+    else
+      payload_merger(std::span<ForwardIterator const>{equal_keys}, result);
+  }
+
+  return result;
+}
+
+namespace detail {
+
+// Return the split positions of all sequences such that (approximately) rank elements come before the split,
+// while equivalent elements are never separated (the split is at the lower_bound of some key in every sequence).
+template<typename RandomAccessIterator, typename Compare>
+std::vector<RandomAccessIterator> k_way_co_rank(std::vector<std::pair<RandomAccessIterator, RandomAccessIterator>> const& sequences, size_t rank, Compare& comp)
+{
+  int const k = sequences.size();
+  auto lower_bound_rank = [&](auto const& key){
+    size_t total = 0;
+    for (auto const& sequence : sequences)
+      total += std::lower_bound(sequence.first, sequence.second, key, comp) - sequence.first;
+    return total;
+  };
+
+  // Find the largest key x with lower_bound_rank(x) <= rank.
+  // The candidates are the elements in [lo[s], hi[s]) of each sequence s.
+  std::vector<RandomAccessIterator> lo(k), hi(k);
+  for (int s = 0; s < k; ++s)
+  {
+    lo[s] = sequences[s].first;
+    hi[s] = sequences[s].second;
+  }
+  RandomAccessIterator best;
+  bool have_best = false;
+  for (;;)
+  {
+    // Take the middle element of the largest remaining window as pivot.
+    int largest = 0;
+    for (int s = 1; s < k; ++s)
+      if (hi[s] - lo[s] > hi[largest] - lo[largest])
+        largest = s;
+    if (lo[largest] == hi[largest])
+      break;
+    RandomAccessIterator pivot = lo[largest] + (hi[largest] - lo[largest]) / 2;
+    if (lower_bound_rank(*pivot) <= rank)
+    {
+      // pivot is a candidate; everything not larger than it is not a better one.
+      best = pivot;
+      have_best = true;
+      for (int s = 0; s < k; ++s)
+        lo[s] = std::max(lo[s], std::upper_bound(sequences[s].first, sequences[s].second, *pivot, comp));
+    }
+    else
+    {
+      // Everything not smaller than pivot has a too large rank.
+      for (int s = 0; s < k; ++s)
+        hi[s] = std::min(hi[s], std::lower_bound(sequences[s].first, sequences[s].second, *pivot, comp));
+    }
+    for (int s = 0; s < k; ++s)
+      hi[s] = std::max(hi[s], lo[s]);
+  }
+
+  std::vector<RandomAccessIterator> split(k);
+  for (int s = 0; s < k; ++s)
+    split[s] = have_best ? std::lower_bound(sequences[s].first, sequences[s].second, *best, comp) : sequences[s].first;
+  return split;
+}
+
+} // namespace detail
+
+// Like k_way_merge, but the output is split into number_of_threads slices (by co-ranking:
+// each slice begins with the same key in every input sequence), that are merged in parallel.
+//
+// The input iterators must be random access. Because the size of the output of every slice
+// is not known in advance, each slice is merged into a temporary std::vector, that are then
+// moved to result, in order. The payload_merger and payload_equal are called concurrently
+// from different threads, and payload_merger is passed a std::back_insert_iterator of that
+// vector instead of OutputIterator (so it needs to accept any output iterator).
+template<typename Sequences, typename OutputIterator, typename PayloadMerger, typename Compare, typename PayloadEqual>
+OutputIterator k_way_merge_parallel(Sequences const& sequences, OutputIterator result, int number_of_threads,
+    PayloadMerger payload_merger, Compare comp, PayloadEqual payload_equal)
+{
+  using RandomAccessIterator = decltype(std::begin(sequences)->first);
+  using value_type = typename std::iterator_traits<RandomAccessIterator>::value_type;
+  static_assert(std::random_access_iterator<RandomAccessIterator>, "k_way_merge_parallel requires random access iterators.");
+  ASSERT(number_of_threads >= 1);
+
+  std::vector<std::pair<RandomAccessIterator, RandomAccessIterator>> all(std::begin(sequences), std::end(sequences));
+  size_t total_size = 0;
+  for (auto const& sequence : all)
+    total_size += sequence.second - sequence.first;
+  if (number_of_threads == 1 || total_size < 2 * static_cast<size_t>(number_of_threads))
+    return k_way_merge(all, result, payload_merger, comp, payload_equal);
+
+  // Calculate the boundaries of every slice.
+  std::vector<std::vector<RandomAccessIterator>> splits;
+  splits.reserve(number_of_threads + 1);
+  splits.emplace_back();
+  for (auto const& sequence : all)
+    splits.back().push_back(sequence.first);
+  for (int t = 1; t < number_of_threads; ++t)
+    splits.push_back(detail::k_way_co_rank(all, total_size * t / number_of_threads, comp));
+  splits.emplace_back();
+  for (auto const& sequence : all)
+    splits.back().push_back(sequence.second);
+
+  std::vector<std::vector<value_type>> slices(number_of_threads);
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(number_of_threads - 1);
+    auto merge_slice = [&](int t){
+      std::vector<std::pair<RandomAccessIterator, RandomAccessIterator>> slice_sequences(all.size());
+      for (size_t s = 0; s < all.size(); ++s)
+        slice_sequences[s] = { splits[t][s], splits[t + 1][s] };
+      k_way_merge(slice_sequences, std::back_inserter(slices[t]), payload_merger, comp, payload_equal);
+    };
+    for (int t = 1; t < number_of_threads; ++t)
+      threads.emplace_back(merge_slice, t);
+    merge_slice(0);
+  } // Join all threads.
+
+  for (auto& slice : slices)
+    result = std::move(slice.begin(), slice.end(), result);
+  return result;
+}
+
+} // namespace utils
@@ -0,0 +1,122 @@
+// Test of k_way_merge and k_way_merge_parallel against a reference merge that uses a std::map.
+//
+// Compile (in a project that uses ai-utils as the utils submodule), for example with:
+//
+//   g++ -std=c++20 -O2 -D_GLIBCXX_ASSERTIONS -I. k_way_merge_tst.cxx
+//
+// and run it; it prints "Success!" or aborts with an error message.
+
+#include "sys.h"
+#include "utils/k_way_merge.h"
+#include <algorithm>
+#include <cstdlib>
+#include <forward_list>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+using Element = std::pair<int, int>;            // A key and its payload.
+
+void check(bool condition, char const* what)
+{
+  if (!condition)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    std::abort();
+  }
+}
+
+auto const comp = [](Element const& e1, Element const& e2){ return e1.first < e2.first; };
+auto const payload_equal = [](Element const& e1, Element const& e2){ return e1.second == e2.second; };
+
+// Merge elements with the same key but different payloads by adding the payloads.
+auto const payload_merger = [](auto equal_keys, auto& result){
+  Element merged{equal_keys[0]->first, 0};
+  for (auto element : equal_keys)
+    merged.second += element->second;
+  *result = merged;
+  ++result;
+};
+
+// The expected output, calculated by collecting all payloads per key in a std::map.
+std::vector<Element> reference_merge(std::vector<std::vector<Element>> const& shards)
+{
+  std::map<int, std::vector<int>> payloads;
+  for (auto const& shard : shards)
+    for (Element const& element : shard)
+      payloads[element.first].push_back(element.second);
+  std::vector<Element> result;
+  for (auto const& [key, values] : payloads)
+  {
+    bool const all_equal = std::all_of(values.begin(), values.end(), [&](int value){ return value == values[0]; });
+    int sum = 0;
+    for (int value : values)
+      sum += value;
+    result.emplace_back(key, all_equal ? values[0] : sum);
+  }
+  return result;
+}
+
+void test_random()
+{
+  std::mt19937 generator(9);
+  for (int round = 0; round < 3000; ++round)
+  {
+    // Between 0 and 39 shards, each with up to 60 unique keys; the payloads collide often.
+    std::vector<std::vector<Element>> shards(generator() % 40);
+    for (auto& shard : shards)
+    {
+      std::map<int, int> elements;
+      for (int i = 0, n = generator() % 60; i < n; ++i)
+        elements[generator() % 200] = generator() % 3;
+      shard.assign(elements.begin(), elements.end());
+    }
+    std::vector<Element> const expected = reference_merge(shards);
+
+    using iterator = std::vector<Element>::const_iterator;
+    std::vector<std::pair<iterator, iterator>> sequences;
+    for (auto const& shard : shards)
+      sequences.emplace_back(shard.cbegin(), shard.cend());
+
+    std::vector<Element> output;
+    utils::k_way_merge(sequences, std::back_inserter(output), payload_merger, comp, payload_equal);
+    check(output == expected, "k_way_merge");
+
+    std::vector<Element> buffer(expected.size() + 1);
+    auto end = utils::k_way_merge(sequences, buffer.begin(), payload_merger, comp, payload_equal);
+    check(std::vector<Element>(buffer.begin(), end) == expected, "k_way_merge into an array");
+
+    output.clear();
+    utils::k_way_merge_parallel(sequences, std::back_inserter(output), 1 + generator() % 8, payload_merger, comp, payload_equal);
+    check(output == expected, "k_way_merge_parallel");
+
+    // Forward iterators suffice for k_way_merge.
+    std::vector<std::forward_list<Element>> lists;
+    for (auto const& shard : shards)
+      lists.emplace_back(shard.begin(), shard.end());
+    using list_iterator = std::forward_list<Element>::const_iterator;
+    std::vector<std::pair<list_iterator, list_iterator>> list_sequences;
+    for (auto const& list : lists)
+      list_sequences.emplace_back(list.cbegin(), list.cend());
+    output.clear();
+    utils::k_way_merge(list_sequences, std::back_inserter(output), payload_merger, comp, payload_equal);
+    check(output == expected, "k_way_merge of std::forward_list");
+  }
+}
+
+} // namespace
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  test_random();
+
+  std::cout << "Success!" << std::endl;
+}
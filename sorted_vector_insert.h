@@ -18,4 +18,26 @@ typename std::vector<T>::iterator sorted_vector_insert(std::vector<T>& vec, T co
   return vec.insert(std::upper_bound( vec.begin(), vec.end(), item, compare), item);
 }
 
+// Insert all elements of [first, last) into the sorted vector vec.
+//
+// This appends the new elements, sorts them and merges them with the existing elements,
+// which is O(n + m log m) instead of the O(n m) of calling sorted_vector_insert m times.
+// The result is the same: equivalent elements keep their relative (insertion) order.
+// See also FlatSet.h.
+template<typename T, typename InputIt, typename Compare>
+void sorted_vector_insert(std::vector<T>& vec, InputIt first, InputIt last, Compare compare)
+{
+  auto old_size = vec.size();
+  vec.insert(vec.end(), first, last);
+  auto middle = vec.begin() + old_size;
+  std::stable_sort(middle, vec.end(), compare);
+  std::inplace_merge(vec.begin(), middle, vec.end(), compare);
+}
+
+template<typename T, typename InputIt>
+void sorted_vector_insert(std::vector<T>& vec, InputIt first, InputIt last)
+{
+  sorted_vector_insert(vec, first, last, std::less<T>{});
+}
+
 } // namespace utils
@@ -2,7 +2,14 @@
 
 #include <string_view>
 #include <array>
+#include <cstring>
+#include <cstdint>
+#include <new>
 #include "utils/AIAlert.h"
+#include "utils/ctz.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace utils {
 
@@ -12,42 +19,212 @@ namespace utils {
 template<typename L>
 void split(std::string_view str, char delim, L found_token)
 {
-  auto first = str.begin();
-  auto const end = str.end();
-  for (auto iter = first;; ++iter)
+  size_t first = 0;
+  for (;;)
   {
-    if (iter == end || *iter == delim)
+    size_t pos = str.find(delim, first);          // Uses memchr.
+    if (pos == std::string_view::npos)
     {
-      found_token(std::string_view{first, static_cast<size_t>(iter - first)});
-      if (iter == end)
-        break;
-      first = iter + 1;
+      found_token(str.substr(first));
+      break;
     }
+    found_token(str.substr(first, pos - first));
+    first = pos + 1;
   }
 }
 
+enum class split_errc
+{
+  success,
+  too_many_delimiters,
+  not_enough_delimiters
+};
+
+// Split str into exactly N tokens. Returns an error instead of throwing.
+template<size_t N>
+split_errc splitN(std::string_view str, char delim, std::array<std::string_view, N>& output, std::nothrow_t)
+{
+  static_assert(N > 0, "splitN requires at least one token.");
+  size_t first = 0;
+  for (size_t i = 0; i < N - 1; ++i)
+  {
+    size_t pos = str.find(delim, first);
+    if (pos == std::string_view::npos)
+      return split_errc::not_enough_delimiters;
+    output[i] = str.substr(first, pos - first);
+    first = pos + 1;
+  }
+  std::string_view last = str.substr(first);
+  if (last.find(delim) != std::string_view::npos)
+    return split_errc::too_many_delimiters;
+  output[N - 1] = last;
+  return split_errc::success;
+}
+
 template<size_t N>
 void splitN(std::string_view str, char delim, std::array<std::string_view, N>& output)
 {
-  int i = 0;
-  auto first = str.begin();
-  auto const end = str.end();
-  for (auto iter = first;; ++iter)
+  switch (splitN(str, delim, output, std::nothrow))
   {
-    if (iter == end || *iter == delim)
+    case split_errc::success:
+      break;
+    case split_errc::too_many_delimiters:
+      THROW_ALERT("Too many separator characters ('[DELIM]') in \"[STR]\" (exactly [N] [VERB] required)",
+          AIArgs("[DELIM]", delim)("[STR]", str)("[N]", N - 1)("[VERB]", N == 2 ? "is" : "are"));
+    case split_errc::not_enough_delimiters:
+      THROW_ALERT("Not enough separator characters ('[DELIM]') in \"[STR]\" (exactly [N] [VERB] required)",
+          AIArgs("[DELIM]", delim)("[STR]", str)("[N]", N - 1)("[VERB]", N == 2 ? "is" : "are"));
+  }
+}
+
+// A set of delimiter characters (plus optionally a quote character) that can be searched for quickly.
+//
+// With a single character the search uses memchr; with up to max_simd characters
+// it compares 16 bytes at a time (SSE2); otherwise it uses a lookup table.
+class DelimiterSet
+{
+ public:
+  static constexpr size_t max_simd = 8;
+
+ private:
+  std::array<uint64_t, 4> m_table;      // Bit c is set iff c is a delimiter (or the quote character).
+  std::array<char, max_simd> m_chars;
+  size_t m_size;                        // The number of characters in m_chars, or max_simd + 1 if there are more.
+
+ public:
+  DelimiterSet(std::string_view delimiters, char quote = 0) : m_table{}, m_chars{}, m_size(0)
+  {
+    auto add = [this](char c){
+      unsigned char uc = c;
+      if (m_table[uc / 64] & (uint64_t{1} << (uc % 64)))
+        return;
+      m_table[uc / 64] |= uint64_t{1} << (uc % 64);
+      if (m_size < max_simd)
+        m_chars[m_size] = c;
+      ++m_size;
+    };
+    for (char c : delimiters)
+      add(c);
+    if (quote)
+      add(quote);
+  }
+
+  bool contains(char c) const
+  {
+    unsigned char uc = c;
+    return m_table[uc / 64] & (uint64_t{1} << (uc % 64));
+  }
+
+  // Return a pointer to the first character in [begin, end) that is in the set, or end.
+  char const* find_first(char const* begin, char const* end) const
+  {
+    if (m_size == 1)
     {
-      output[i++] = std::string_view{first, static_cast<size_t>(iter - first)};
-      if (iter == end)
-        break;
-      if (i == N)
-        THROW_ALERT("Too many separator characters ('[DELIM]') in \"[STR]\" (exactly [N] [VERB] required)",
-            AIArgs("[DELIM]", delim)("[STR]", str)("[N]", N - 1)("[VERB]", N == 2 ? "is" : "are"));
-      first = iter + 1;
+      void const* found = std::memchr(begin, m_chars[0], end - begin);
+      return found ? static_cast<char const*>(found) : end;
     }
+#if defined(__SSE2__)
+    if (m_size <= max_simd)
+    {
+      while (end - begin >= 16)
+      {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin));
+        __m128i match = _mm_setzero_si128();
+        for (size_t i = 0; i < m_size; ++i)
+          match = _mm_or_si128(match, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(m_chars[i])));
+        if (unsigned int mask = _mm_movemask_epi8(match))
+          return begin + utils::ctz(mask);
+        begin += 16;
+      }
+    }
+#endif
+    while (begin != end && !contains(*begin))
+      ++begin;
+    return begin;
   }
-  if (i != N)
-    THROW_ALERT("Not enough separator characters ('[DELIM]') in \"[STR]\" (exactly [N] [VERB] required)",
-        AIArgs("[DELIM]", delim)("[STR]", str)("[N]", N - 1)("[VERB]", N == 2 ? "is" : "are"));
-}
+};
+
+// Tokenizer: iterate lazily over the tokens of a string, separated by any of a set of delimiters.
+//
+// Like split, empty tokens exist and there is always at least one token.
+// If a quote character is given, then delimiters between a pair of quotes
+// do not end a token; a token that starts with a quote and ends with the
+// matching quote is returned without those quotes (doubled quotes inside
+// are returned as is). An unterminated quote extends to the end of the string.
+//
+// Usage:
+//
+//   for (std::string_view token : utils::Tokenizer(line, ",;", '"'))
+//     ...
+//
+class Tokenizer
+{
+ private:
+  std::string_view m_str;
+  DelimiterSet m_delimiters;            // Includes m_quote, if any.
+  char m_quote;
+
+ public:
+  Tokenizer(std::string_view str, std::string_view delimiters, char quote = 0) : m_str(str), m_delimiters(delimiters, quote), m_quote(quote) { }
+  Tokenizer(std::string_view str, char delim) : m_str(str), m_delimiters(std::string_view{&delim, 1}), m_quote(0) { }
+
+  class iterator
+  {
+   private:
+    Tokenizer const* m_tokenizer;       // nullptr for end().
+    size_t m_next;                      // The offset of the next token, or npos when there is no next token.
+    std::string_view m_token;
+
+    void find_token()
+    {
+      if (m_next == std::string_view::npos)
+      {
+        m_tokenizer = nullptr;          // Becomes end().
+        return;
+      }
+      std::string_view const& str = m_tokenizer->m_str;
+      char const quote = m_tokenizer->m_quote;
+      char const* const end = str.data() + str.size();
+      char const* const first = str.data() + m_next;
+      char const* pos = first;
+      bool quoted = false;
+      for (;;)
+      {
+        pos = m_tokenizer->m_delimiters.find_first(pos, end);
+        if (pos == end || !quote || *pos != quote)
+          break;
+        // Skip to the matching quote.
+        quoted = true;
+        void const* closing = std::memchr(pos + 1, quote, end - pos - 1);
+        pos = closing ? static_cast<char const*>(closing) + 1 : end;
+      }
+      if (quoted && pos - first >= 2 && *first == quote && pos[-1] == quote)
+        m_token = std::string_view{first + 1, static_cast<size_t>(pos - first - 2)};
+      else
+        m_token = std::string_view{first, static_cast<size_t>(pos - first)};
+      m_next = pos == end ? std::string_view::npos : pos + 1 - str.data();
+    }
+
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::string_view const*;
+    using reference = std::string_view const&;
+
+    iterator() : m_tokenizer(nullptr), m_next(std::string_view::npos) { }
+    iterator(Tokenizer const* tokenizer) : m_tokenizer(tokenizer), m_next(0) { find_token(); }
+
+    reference operator*() const { return m_token; }
+    pointer operator->() const { return &m_token; }
+    iterator& operator++() { find_token(); return *this; }
+    iterator operator++(int) { iterator result(*this); find_token(); return result; }
+
+    friend bool operator==(iterator const& i1, iterator const& i2) { return i1.m_tokenizer == i2.m_tokenizer && i1.m_next == i2.m_next; }
+  };
+
+  iterator begin() const { return {this}; }
+  iterator end() const { return {}; }
+};
 
 } // namespace utils
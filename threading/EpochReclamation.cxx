@@ -0,0 +1,254 @@
+#include "sys.h"
+#include "EpochReclamation.h"
+#include "debug.h"
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils::threading::epoch {
+namespace {
+
+struct Retired
+{
+  void const* m_ptr;
+  deleter_type m_deleter;
+};
+
+struct Bag
+{
+  uint64_t m_epoch;                             // The global epoch at the moment that the bag was sealed.
+  std::vector<Retired> m_objects;
+};
+
+// The number of objects that are retired before they are sealed (and an attempt is made to delete older bags).
+constexpr size_t bag_size = 64;
+
+// A thread in collect_deferred mode collects anyway when this many bags are waiting for another thread.
+constexpr size_t max_orphans = 1024;
+
+struct ThreadData : detail::ThreadRecord
+{
+  std::vector<Retired> m_bag;                   // The objects retired by this thread that aren't sealed yet.
+  std::vector<Bag> m_sealed;                    // Sealed bags, oldest first.
+  bool m_collecting{false};                     // Set while deleting objects (which might retire more objects).
+  bool m_orphaned{false};                       // Set if this record was created after the thread already exited.
+  collect_mode_nt m_collect_mode{collect_inline};       // What retire() does with a full bag.
+};
+
+struct Registry
+{
+  std::mutex m_mutex;
+  std::vector<ThreadData*> m_threads;           // All registered threads. Protected by m_mutex.
+  std::vector<Bag> m_orphans;                   // Bags of threads that exited or that are in collect_deferred mode. Protected by m_mutex.
+};
+
+Registry& registry()
+{
+  static Registry s_registry;
+  return s_registry;
+}
+
+// Set when the current thread is exiting.
+constinit thread_local bool t_exiting = false;
+
+// Two epochs must have passed since a bag was sealed before it is safe to delete it.
+bool expired(Bag const& bag, uint64_t global_epoch)
+{
+  return global_epoch - bag.m_epoch >= 2;
+}
+
+void seal(ThreadData* thread_data)
+{
+  if (thread_data->m_bag.empty())
+    return;
+  // Everything in the bag was made unreachable before the global epoch is read.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t global_epoch = detail::g_global_epoch.load(std::memory_order_relaxed);
+  thread_data->m_sealed.push_back({ global_epoch, std::move(thread_data->m_bag) });
+  thread_data->m_bag.clear();
+}
+
+// Try to advance the global epoch and move the orphaned bags that expired to garbage.
+// If wait is false and another thread is doing the same, then nothing is done.
+// Returns the (new) global epoch.
+uint64_t advance(bool wait, std::vector<Bag>& garbage, bool* orphans_left = nullptr)
+{
+  Registry& r = registry();
+  std::unique_lock<std::mutex> lock(r.m_mutex, std::defer_lock);
+  if (wait)
+    lock.lock();
+  else if (!lock.try_lock())
+    return detail::g_global_epoch.load(std::memory_order_relaxed);
+
+  // Only this function changes the global epoch, while holding the lock.
+  uint64_t global_epoch = detail::g_global_epoch.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  // The global epoch can only be advanced if every thread that is inside a critical section entered it during the current epoch.
+  if (std::all_of(r.m_threads.begin(), r.m_threads.end(), [global_epoch](ThreadData const* thread_data){
+        uint64_t local_epoch = thread_data->m_local_epoch.load(std::memory_order_relaxed);
+        return !(local_epoch & 1) || (local_epoch >> 1) == global_epoch;
+      }))
+  {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    detail::g_global_epoch.store(++global_epoch, std::memory_order_release);
+  }
+
+  auto keep = std::stable_partition(r.m_orphans.begin(), r.m_orphans.end(), [global_epoch](Bag const& bag){ return !expired(bag, global_epoch); });
+  std::move(keep, r.m_orphans.end(), std::back_inserter(garbage));
+  r.m_orphans.erase(keep, r.m_orphans.end());
+  if (orphans_left)
+    *orphans_left = !r.m_orphans.empty();
+  return global_epoch;
+}
+
+// Move the bags of the current thread that expired to garbage.
+void take_expired(ThreadData* thread_data, uint64_t global_epoch, std::vector<Bag>& garbage)
+{
+  auto end = std::find_if(thread_data->m_sealed.begin(), thread_data->m_sealed.end(),
+      [global_epoch](Bag const& bag){ return !expired(bag, global_epoch); });
+  std::move(thread_data->m_sealed.begin(), end, std::back_inserter(garbage));
+  thread_data->m_sealed.erase(thread_data->m_sealed.begin(), end);
+}
+
+void delete_garbage(ThreadData* thread_data, std::vector<Bag>& garbage)
+{
+  thread_data->m_collecting = true;
+  for (Bag const& bag : garbage)
+    for (Retired const& retired : bag.m_objects)
+      retired.m_deleter(retired.m_ptr);
+  thread_data->m_collecting = false;
+}
+
+// Hand the sealed bags of thread_data to the other threads.
+// Returns the number of bags that are now waiting to be deleted by another thread.
+size_t orphan(ThreadData* thread_data, bool unregister)
+{
+  seal(thread_data);
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.m_mutex);
+  std::move(thread_data->m_sealed.begin(), thread_data->m_sealed.end(), std::back_inserter(r.m_orphans));
+  thread_data->m_sealed.clear();
+  if (unregister)
+    r.m_threads.erase(std::find(r.m_threads.begin(), r.m_threads.end(), thread_data));
+  return r.m_orphans.size();
+}
+
+ThreadData* new_thread_data()
+{
+  ThreadData* thread_data = new ThreadData;
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.m_mutex);
+  r.m_threads.push_back(thread_data);
+  return thread_data;
+}
+
+// Destroyed when the thread exits.
+struct ThreadDataOwner
+{
+  ThreadData* m_thread_data;
+
+  ThreadDataOwner() : m_thread_data(new_thread_data()) { }
+
+  ~ThreadDataOwner()
+  {
+    // A thread should not exit while inside a critical section.
+    ASSERT(m_thread_data->m_nesting == 0);
+    orphan(m_thread_data, true);
+    detail::t_thread_record = nullptr;
+    t_exiting = true;
+    delete m_thread_data;
+  }
+};
+
+ThreadData* this_thread_data()
+{
+  detail::ThreadRecord* thread_record = detail::t_thread_record;
+  if (AI_UNLIKELY(!thread_record))
+    thread_record = detail::register_thread();
+  return static_cast<ThreadData*>(thread_record);
+}
+
+} // namespace
+
+namespace detail {
+
+std::atomic<uint64_t> g_global_epoch;
+
+ThreadRecord* register_thread()
+{
+  if (AI_UNLIKELY(t_exiting))
+  {
+    // This thread is exiting; it can't have a thread_local ThreadDataOwner anymore.
+    // Use a record that is never freed and of which all retired objects are orphaned immediately.
+    ThreadData* thread_data = new_thread_data();
+    thread_data->m_orphaned = true;
+    t_thread_record = thread_data;
+    return thread_data;
+  }
+  static thread_local ThreadDataOwner s_thread_data_owner;
+  t_thread_record = s_thread_data_owner.m_thread_data;
+  return t_thread_record;
+}
+
+} // namespace detail
+
+void retire(void const* ptr, deleter_type deleter)
+{
+  ThreadData* thread_data = this_thread_data();
+  thread_data->m_bag.push_back({ ptr, deleter });
+  if (AI_UNLIKELY(thread_data->m_orphaned))
+    orphan(thread_data, false);
+  else if (thread_data->m_bag.size() >= bag_size)
+  {
+    if (thread_data->m_collect_mode == collect_inline)
+      collect();
+    // Leave deleting the bag to another thread, unless too many bags are waiting already.
+    else if (orphan(thread_data, false) >= max_orphans)
+      collect();
+  }
+}
+
+void set_collect_mode(collect_mode_nt collect_mode)
+{
+  this_thread_data()->m_collect_mode = collect_mode;
+}
+
+void collect()
+{
+  ThreadData* thread_data = this_thread_data();
+  seal(thread_data);
+  // Don't delete anything while already deleting objects.
+  if (thread_data->m_collecting)
+    return;
+  std::vector<Bag> garbage;
+  uint64_t global_epoch = advance(false, garbage);
+  take_expired(thread_data, global_epoch, garbage);
+  delete_garbage(thread_data, garbage);
+}
+
+void flush()
+{
+  ThreadData* thread_data = this_thread_data();
+  // Calling flush() from inside a critical section would dead-lock.
+  ASSERT(thread_data->m_nesting == 0 && !thread_data->m_collecting);
+  for (;;)
+  {
+    seal(thread_data);
+    std::vector<Bag> garbage;
+    bool orphans_left;
+    uint64_t global_epoch = advance(true, garbage, &orphans_left);
+    take_expired(thread_data, global_epoch, garbage);
+    if (garbage.empty())
+    {
+      if (thread_data->m_sealed.empty() && !orphans_left)
+        break;
+      // Another thread is still in a critical section that it entered during an older epoch.
+      std::this_thread::yield();
+    }
+    // Deleting objects can retire more objects, so keep going until nothing is left.
+    delete_garbage(thread_data, garbage);
+  }
+}
+
+} // namespace utils::threading::epoch
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "utils/macros.h"
+#include <atomic>
+#include <cstdint>
+
+// Epoch-based reclamation.
+//
+// Lock-free readers that hold raw pointers to objects that can be removed from a shared
+// data structure by another thread must be sure that those objects aren't deleted while
+// they are using them. Instead of deleting a removed object immediately, the thread that
+// removed it retires it; it is deleted later, in a batch, once every thread that was
+// reading at the moment it was retired has left its critical section.
+//
+// Usage:
+//
+//   // Reader.
+//   {
+//     utils::threading::EpochGuard guard;              // Enter critical section.
+//     Node* node = head.load(std::memory_order_acquire);
+//     ...                                              // node can be used until guard is destroyed.
+//   }
+//
+//   // Writer.
+//   Node* old = head.exchange(new_node);
+//   utils::threading::epoch::retire(old);              // Deleted later.
+//
+// Retired objects are collected per thread in a bag; when the bag is full it is sealed with
+// the current global epoch and an attempt is made to advance the global epoch. The global
+// epoch can only be advanced when every thread that is inside a critical section entered it
+// during the current epoch, so a bag that was sealed at least two epochs ago can be deleted.
+// Objects that are still retired when a thread exits are handed to the thread that next
+// collects.
+//
+// By default a thread deletes its own expired bags when it seals a full bag, so that every
+// so many calls to retire() pay for deleting a batch of objects. A thread for which that
+// is too expensive (for example, one that handles requests) can call
+//
+//   utils::threading::epoch::set_collect_mode(utils::threading::epoch::collect_deferred);
+//
+// after which its full bags are handed to other threads, like the bags of a thread that
+// exited. They are then deleted by the next thread that calls collect() or flush(), for
+// example a thread that becomes idle, or a dedicated reclaimer thread that calls collect()
+// periodically. In case no thread does that, a thread in collect_deferred mode still
+// collects when too many bags are waiting.
+//
+// Entering and leaving a critical section is cheap (a store and a fence) and never blocks;
+// critical sections may be nested but should be short, since a thread that stays inside
+// one prevents the deletion of everything that is retired by any thread.
+//
+namespace utils::threading {
+
+namespace epoch {
+
+using deleter_type = void (*)(void const*);
+
+// What retire() does when the bag of the current thread is full.
+enum collect_mode_nt
+{
+  collect_inline,               // Seal the bag and delete the expired bags right away (the default).
+  collect_deferred              // Seal the bag and leave deleting it to the next thread that calls collect() or flush().
+};
+
+namespace detail {
+
+// The part of the per thread record that is used inline.
+struct ThreadRecord
+{
+  std::atomic<uint64_t> m_local_epoch{0};       // The epoch (shifted left by one) at which the thread entered a critical section, plus one; or zero if not in one.
+  int m_nesting{0};                             // The number of EpochGuard objects of this thread.
+};
+
+extern std::atomic<uint64_t> g_global_epoch;
+inline constinit thread_local ThreadRecord* t_thread_record = nullptr;
+
+ThreadRecord* register_thread();
+
+inline void enter()
+{
+  ThreadRecord* thread_record = t_thread_record;
+  if (AI_UNLIKELY(!thread_record))
+    thread_record = register_thread();
+  if (thread_record->m_nesting++ == 0)
+  {
+    thread_record->m_local_epoch.store((g_global_epoch.load(std::memory_order_relaxed) << 1) | 1, std::memory_order_relaxed);
+    // Make sure that the store above is visible to other threads before we read any pointer.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+inline void leave()
+{
+  ThreadRecord* thread_record = t_thread_record;
+  if (--thread_record->m_nesting == 0)
+    thread_record->m_local_epoch.store(0, std::memory_order_release);
+}
+
+} // namespace detail
+
+// Delete ptr with deleter once no thread can still be using it.
+// The object must already be unreachable for threads that enter a critical section from now on.
+void retire(void const* ptr, deleter_type deleter);
+
+template<typename T>
+void retire(T const* ptr)
+{
+  retire(ptr, [](void const* p){ delete static_cast<T const*>(p); });
+}
+
+// Set the collect mode of the current thread.
+void set_collect_mode(collect_mode_nt collect_mode);
+
+// Seal the objects that the current thread retired so far, try to advance the global epoch
+// and delete everything that can be deleted, including the expired bags of threads that
+// exited or that are in collect_deferred mode. In collect_inline mode this is done
+// automatically every so many calls to retire, but can be called explicitly, for example
+// when a thread becomes idle.
+void collect();
+
+// Delete everything that was retired by the current thread, or by threads that exited,
+// waiting for other threads to leave their critical sections when necessary.
+// Must not be called from inside a critical section.
+void flush();
+
+} // namespace epoch
+
+// A critical section: objects that are retired by any thread while an EpochGuard exists
+// are not deleted before the EpochGuard is destroyed.
+class EpochGuard
+{
+ public:
+  EpochGuard() { epoch::detail::enter(); }
+  ~EpochGuard() { epoch::detail::leave(); }
+
+  EpochGuard(EpochGuard const&) = delete;
+  EpochGuard& operator=(EpochGuard const&) = delete;
+};
+
+} // namespace utils::threading
@@ -26,26 +26,146 @@
  */
 
 #include "translate.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace translate {
 
-std::string getString(std::string const& xmlDesc, format_map_t const& format_map)
+namespace {
+
+// A description, parsed into literal text and placeholders.
+//
+// The placeholders are found in a single left to right scan over the description,
+// taking at each position the first key (in format_map_t order) that matches.
+// This is the same as replacing each key in turn, as long as no key is a substring
+// of another key and replacements do not contain keys.
+class CompiledTemplate
 {
-  std::string result = xmlDesc;
-  for (format_map_t::const_iterator iter = format_map.begin(); iter != format_map.end(); ++iter)
+ private:
+  struct Segment
+  {
+    size_t m_literal_begin;             // The literal text that precedes the placeholder.
+    size_t m_literal_length;
+    size_t m_key;                       // The index into m_keys of the placeholder, or no_key if this is the trailing literal text.
+  };
+  static constexpr size_t no_key = static_cast<size_t>(-1);
+
+  std::string m_source;
+  std::vector<std::string> m_keys;      // The keys that this template was compiled for.
+  std::vector<Segment> m_segments;
+
+ public:
+  CompiledTemplate(std::string const& xml_desc, format_map_t const& format_map) : m_source(xml_desc)
+  {
+    for (auto const& key_value : format_map)
+      m_keys.push_back(key_value.first);
+    size_t literal_begin = 0;
+    size_t pos = 0;
+    while (pos < m_source.size())
+    {
+      size_t key = 0;
+      while (key < m_keys.size() && (m_keys[key].empty() || m_source.compare(pos, m_keys[key].size(), m_keys[key]) != 0))
+        ++key;
+      if (key == m_keys.size())
+      {
+        ++pos;
+        continue;
+      }
+      m_segments.push_back({literal_begin, pos - literal_begin, key});
+      pos += m_keys[key].size();
+      literal_begin = pos;
+    }
+    m_segments.push_back({literal_begin, m_source.size() - literal_begin, no_key});
+  }
+
+  // Return true if this template was compiled for the keys of format_map.
+  bool compiled_for(format_map_t const& format_map) const
+  {
+    if (format_map.size() != m_keys.size())
+      return false;
+    auto key = m_keys.begin();
+    for (auto const& key_value : format_map)
+      if (key_value.first != *key++)
+        return false;
+    return true;
+  }
+
+  std::string render(format_map_t const& format_map) const
   {
-    size_t start_pos = 0;
-    while(1)
+    // Look up the replacements once.
+    std::vector<std::string const*> values;
+    values.reserve(format_map.size());
+    for (auto const& key_value : format_map)
+      values.push_back(&key_value.second);
+
+    size_t size = 0;
+    for (Segment const& segment : m_segments)
+      size += segment.m_literal_length + (segment.m_key == no_key ? 0 : values[segment.m_key]->size());
+
+    std::string result;
+    result.reserve(size);
+    for (Segment const& segment : m_segments)
     {
-      size_t pos = result.find(iter->first, start_pos);
-      if (pos == std::string::npos)
-	break;
-      size_t len = iter->first.length();
-      result.replace(pos, len, iter->second);
-      start_pos = pos + iter->second.length();
+      result.append(m_source, segment.m_literal_begin, segment.m_literal_length);
+      if (segment.m_key != no_key)
+        result.append(*values[segment.m_key]);
     }
+    return result;
   }
-  return result;
+};
+
+// Cache of compiled templates, keyed by description.
+//
+// Lookups only take a shared lock. Descriptions are usually string literals, but they
+// don't have to be, so the number of entries is bounded: when the cache is full it is
+// emptied before a new description is added.
+class TemplateCache
+{
+ private:
+  static constexpr size_t max_entries = 1024;
+
+  std::shared_mutex m_mutex;
+  std::unordered_map<std::string, std::shared_ptr<CompiledTemplate const>> m_templates;
+
+ public:
+  std::shared_ptr<CompiledTemplate const> get(std::string const& xml_desc, format_map_t const& format_map)
+  {
+    {
+      std::shared_lock<std::shared_mutex> lock(m_mutex);
+      auto entry = m_templates.find(xml_desc);
+      // Recompile if this description is used with a different set of keys.
+      if (entry != m_templates.end() && entry->second->compiled_for(format_map))
+        return entry->second;
+    }
+    auto compiled_template = std::make_shared<CompiledTemplate const>(xml_desc, format_map);
+    std::lock_guard<std::shared_mutex> lock(m_mutex);
+    if (m_templates.size() >= max_entries && !m_templates.contains(xml_desc))
+      m_templates.clear();
+    m_templates.insert_or_assign(xml_desc, compiled_template);
+    return compiled_template;
+  }
+};
+
+// The cache is created on first use and never destroyed, because getString is also
+// called (by THROW_ALERT) during the initialization and destruction of static objects.
+TemplateCache& template_cache()
+{
+  static TemplateCache* s_template_cache = new TemplateCache;
+  return *s_template_cache;
+}
+
+} // namespace
+
+std::string getString(std::string const& xmlDesc, format_map_t const& format_map)
+{
+  if (format_map.empty())
+    return xmlDesc;
+
+  std::shared_ptr<CompiledTemplate const> compiled_template = template_cache().get(xmlDesc, format_map);
+  return compiled_template->render(format_map);
 }
 
 } // namespace translate
@@ -1,31 +1,20 @@
 #include "sys.h"
 #include "u8string_to_filename.h"
 #include "utf8_glyph_length.h"
+#include "ctz.h"
+#include "macros.h"
 #include "debug.h"
-#include <vector>
-#include <string_view>
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace utils {
 namespace detail::us2f {
 
 static constexpr char8_t escape = '%';
 
-std::u8string to_hex_string(char8_t c);
-
-class Dictionary
-{
- private:
-  std::vector<std::u8string_view> m_words;
-
- public:
-  Dictionary(std::u8string const&);
-
-  size_t size() const { return m_words.size(); }
-  void add(std::u8string_view glyph);
-  int find(std::u8string_view glyph) const;
-  std::u8string_view operator[](int index) const { return m_words[index]; }
-};
-
 char8_t to_hex_digit(int d)
 {
   if (d < 10)
@@ -33,21 +22,24 @@ char8_t to_hex_digit(int d)
   return 'A' + d - 10;
 }
 
-std::u8string to_hex_string(char8_t c)
+// Like utf8_glyph_length, but never reads beyond end.
+int glyph_length(char8_t const* glyph, char8_t const* end)
 {
-  std::u8string hex_string;
-  hex_string += to_hex_digit(c / 16);
-  hex_string += to_hex_digit(c % 16);
-  return hex_string;
+  if (AI_LIKELY(end - glyph >= 4))
+    return utf8_glyph_length(glyph);
+  // Copy the last few bytes to a zero terminated buffer.
+  char8_t buf[4] = {};
+  std::copy(glyph, end, buf);
+  return utf8_glyph_length(buf);
 }
 
-Dictionary::Dictionary(std::u8string const& in)
+Dictionary::Dictionary(std::u8string_view in)
 {
   // Run over each glyph in the input.
   int glen;     // The number of bytes of the current glyph.
-  for (char8_t const* glyph = in.data(); *glyph; glyph += glen)
+  for (char8_t const* glyph = in.data(); glyph != in.data() + in.size(); glyph += glen)
   {
-    glen = utf8_glyph_length(glyph);
+    glen = glyph_length(glyph, in.data() + in.size());
     m_words.emplace_back(glyph, glen);
   }
 }
@@ -55,7 +47,7 @@ Dictionary::Dictionary(std::u8string const& in)
 void Dictionary::add(std::u8string_view glyph)
 {
   if (find(glyph) == -1)
-    m_words.push_back(glyph);
+    m_words.emplace_back(glyph);
 }
 
 int Dictionary::find(std::u8string_view glyph) const
@@ -66,9 +58,66 @@ int Dictionary::find(std::u8string_view glyph) const
   return -1;
 }
 
-} // namespace utils::detail
+void SpecialByteScanner::add(char8_t c)
+{
+  if (c >= m_is_special.size() || m_is_special[c])
+    return;
+  m_is_special[c] = true;
+  if (m_number_of_specials < static_cast<int>(m_specials.size()))
+    m_specials[m_number_of_specials] = c;
+  ++m_number_of_specials;
+}
+
+char8_t const* SpecialByteScanner::find(char8_t const* begin, char8_t const* end) const
+{
+#if defined(__SSE2__)
+  // There are normally only a few special characters (four with the default translation tables).
+  if (m_number_of_specials <= static_cast<int>(m_specials.size()))
+  {
+    while (end - begin >= 16)
+    {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin));
+      // The sign bit of non-ASCII bytes is set.
+      unsigned int mask = _mm_movemask_epi8(chunk);
+      for (int i = 0; i < m_number_of_specials; ++i)
+        mask |= _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(m_specials[i])));
+      if (mask)
+        return begin + utils::ctz(mask);
+      begin += 16;
+    }
+  }
+#endif
+  while (begin != end && *begin < m_is_special.size() && !m_is_special[*begin])
+    ++begin;
+  return begin;
+}
+
+} // namespace detail::us2f
+
+FilenameTranslator::FilenameTranslator(std::u8string_view illegal, std::u8string_view from, std::u8string_view to) :
+  m_illegal(illegal), m_from(from), m_to(to)
+{
+  using namespace detail::us2f;
+
+  // The escape character is always illegal (is not allowed to appear on its own in the output).
+  m_illegal.add({ &escape, 1 });
+  // As is a zero byte.
+  static constexpr char8_t nul = 0;
+  m_illegal.add({ &nul, 1 });
+
+  // For each `from` entry there must exist one `to` entry.
+  ASSERT(m_from.size() == m_to.size());
+
+  // All glyphs are found by their first byte.
+  for (Dictionary const* dictionary : { &m_illegal, &m_from, &m_to })
+    for (size_t i = 0; i < dictionary->size(); ++i)
+      m_encode_scanner.add((*dictionary)[i][0]);
+  m_decode_scanner.add(escape);
+  for (size_t i = 0; i < m_to.size(); ++i)
+    m_decode_scanner.add(m_to[i][0]);
+}
 
-// Copy str to the returned filename, replacing every occurance of
+// Copy str to out, replacing every occurance of
 // the UTF8 glyphs in `from` with the corresponding one in `to`.
 //
 // All glyphs in `illegal` will be escaped with a percentage sign (%)
@@ -81,46 +130,43 @@ int Dictionary::find(std::u8string_view glyph) const
 // All glyphs in `to` that are not in `from` are considered illegal
 // and will also be escaped.
 //
-std::filesystem::path u8string_to_filename(std::u8string const& str, std::u8string const& illegal, std::u8string const& from, std::u8string const& to)
+char8_t* FilenameTranslator::encode(char8_t* out, std::u8string_view str) const
 {
   using namespace detail::us2f;
 
-  // All glyphs are found by their first byte.
-  // Build a dictionary for each of the three strings.
-  Dictionary from_dictionary(from);
-  Dictionary to_dictionary(to);
-  Dictionary illegal_dictionary(illegal);
-
-  // The escape character is always illegal (is not allowed to appear on its own in the output).
-  illegal_dictionary.add({ &escape, 1 });
-
-  // For each `from` entry there must exist one `to` entry.
-  ASSERT(from_dictionary.size() == to_dictionary.size());
-
-  std::filesystem::path filename;
+  char8_t const* gp = str.data();
+  char8_t const* const end = gp + str.size();
 
   // Run over all glyphs in the input string.
-  int glen;     // The number of bytes of the current glyph.
-  for (char8_t const* gp = str.data(); *gp; gp += glen)
+  for (;;)
   {
-    glen = utf8_glyph_length(gp);
+    // Copy the ASCII characters that are not translated or escaped in one go.
+    char8_t const* special = m_encode_scanner.find(gp, end);
+    std::memcpy(out, gp, special - gp);
+    out += special - gp;
+    gp = special;
+    if (gp == end)
+      break;
+
+    int glen = glyph_length(gp, end);
     std::u8string_view glyph(gp, glen);
     // Perform translation.
-    int from_index = from_dictionary.find(glyph);
+    int from_index = m_from.find(glyph);
     if (from_index != -1)
-      glyph = to_dictionary[from_index];
+      glyph = m_to[from_index];
     else if (*gp == escape)
     {
-      filename += escape;
-      filename += escape;
+      *out++ = escape;
+      *out++ = escape;
+      gp += glen;
       continue;
     }
     // What is in illegal is *always* illegal - even when it is the result of a translation.
-    if (illegal_dictionary.find(glyph) != -1 ||
+    if (m_illegal.find(glyph) != -1 ||
         // If an input glyph is not in the from_dictionary (aka, it wasn't just translated) but
         // it is in the to_dictionary - then also escape it. This is necessary to make sure that
         // each unique input str results in a unique filename (and consequently is reversible).
-        (from_index == -1 && to_dictionary.find(glyph) != -1))
+        (from_index == -1 && m_to.find(glyph) != -1))
     {
       // Escape illegal glyphs.
       // Always escape the original input (not a possible translation), otherwise
@@ -128,43 +174,53 @@ std::filesystem::path u8string_to_filename(std::u8string const& str, std::u8stri
       // translated first or not.
       for (int j = 0; j < glen; ++j)
       {
-        filename += escape;
-        filename += to_hex_string(gp[j]);
+        *out++ = escape;
+        *out++ = to_hex_digit(gp[j] / 16);
+        *out++ = to_hex_digit(gp[j] % 16);
       }
-      continue;
     }
-    // Append the glyph to the filename.
-    filename += glyph;
+    else
+    {
+      // Append the glyph to the filename.
+      std::memcpy(out, glyph.data(), glyph.size());
+      out += glyph.size();
+    }
+    gp += glen;
   }
 
-  return filename;
+  return out;
 }
 
-std::u8string filename_to_u8string(std::filesystem::path const& filename, std::u8string const& from, std::u8string const& to)
+char8_t* FilenameTranslator::decode(char8_t* out, std::u8string_view filename) const
 {
   using namespace detail::us2f;
 
-  std::u8string input = filename.u8string();
-  std::u8string result;
+  char8_t const* gp = filename.data();
+  char8_t const* const end = gp + filename.size();
 
-  Dictionary from_dictionary(from);
-  Dictionary to_dictionary(to);
-
-  // First unescape all bytes in the filename.
-  int glen;     // The number of bytes of the current glyph.
-  for (char8_t const* gp = input.c_str(); *gp; gp += glen)
+  for (;;)
   {
-    glen = utf8_glyph_length(gp);
+    // Copy the ASCII characters that were not translated or escaped in one go.
+    char8_t const* special = m_decode_scanner.find(gp, end);
+    std::memcpy(out, gp, special - gp);
+    out += special - gp;
+    gp = special;
+    if (gp == end)
+      break;
+
+    int glen = glyph_length(gp, end);
     std::u8string_view glyph(gp, glen);
     // First translate escape sequences back - those are then always original input.
-    if (*gp == escape)
+    if (*gp == escape && end - gp >= 2)
     {
       if (gp[1] == escape)
       {
         glen = 2;       // Skip the second escape character too.
-        result += escape;
+        *out++ = escape;
+        gp += glen;
+        continue;
       }
-      else
+      else if (end - gp >= 3)
       {
         char8_t val = 0;
         for (int d = 1; d <= 2; ++d)
@@ -172,22 +228,49 @@ std::u8string filename_to_u8string(std::filesystem::path const& filename, std::u
           val <<= 4;
           val |= ('0' <= gp[d] && gp[d] <= '9') ? gp[d] - '0' : gp[d] - 'A' + 10;
         }
-        result += val;
+        *out++ = val;
         glen = 3;       // Skip the two hex digits too.
+        gp += glen;
+        continue;
       }
-      continue;
     }
-    else
-    {
-      // Otherwise - if the character is in the from dictionary, it must have
-      // been translated - otherwise it would have been escaped.
-      int from_index = from_dictionary.find(glyph);
-      if (from_index != -1)
-        glyph = to_dictionary[from_index];
-    }
-    result += glyph;
+    // Otherwise - if the character is in the `to` dictionary, it must have
+    // been translated - otherwise it would have been escaped.
+    int to_index = m_to.find(glyph);
+    if (to_index != -1)
+      glyph = m_from[to_index];
+    std::memcpy(out, glyph.data(), glyph.size());
+    out += glyph.size();
+    gp += glen;
   }
+
+  return out;
+}
+
+std::filesystem::path FilenameTranslator::encode(std::u8string_view str) const
+{
+  std::u8string filename(max_size(str.size()), u8'\0');
+  filename.resize(encode(filename.data(), str) - filename.data());
+  return filename;
+}
+
+std::u8string FilenameTranslator::decode(std::u8string_view filename) const
+{
+  std::u8string result(max_size(filename.size()), u8'\0');
+  result.resize(decode(result.data(), filename) - result.data());
   return result;
 }
 
+// The string is converted up till the first zero byte, if any.
+std::filesystem::path u8string_to_filename(std::u8string const& str, std::u8string const& illegal, std::u8string const& from, std::u8string const& to)
+{
+  return FilenameTranslator(illegal, from, to).encode(str.c_str());
+}
+
+std::u8string filename_to_u8string(std::filesystem::path const& filename, std::u8string const& from, std::u8string const& to)
+{
+  // The `from` and `to` passed here are the `to` and `from` respectively that were used for the encoding.
+  return FilenameTranslator({}, to, from).decode(filename.u8string());
+}
+
 } // namespace utils
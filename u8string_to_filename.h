@@ -2,6 +2,9 @@
 
 #include <filesystem>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <array>
 
 namespace utils {
 
@@ -20,4 +23,80 @@ std::filesystem::path u8string_to_filename(
 // the same translation strings are used (but swapped).
 std::u8string filename_to_u8string(std::filesystem::path const& filename, std::u8string const& from = u8"_\u2017\u2215", std::u8string const& to = u8" _/");
 
+namespace detail::us2f {
+
+class Dictionary
+{
+ private:
+  std::vector<std::u8string> m_words;
+
+ public:
+  Dictionary(std::u8string_view glyphs);
+
+  size_t size() const { return m_words.size(); }
+  void add(std::u8string_view glyph);
+  int find(std::u8string_view glyph) const;
+  std::u8string_view operator[](int index) const { return m_words[index]; }
+};
+
+// Finds the first byte that is not ASCII or that is one of a given set of ASCII characters.
+class SpecialByteScanner
+{
+ private:
+  std::array<bool, 128> m_is_special{};
+  std::array<char8_t, 16> m_specials;   // Only valid if m_number_of_specials <= m_specials.size().
+  int m_number_of_specials{0};
+
+ public:
+  void add(char8_t c);
+  char8_t const* find(char8_t const* begin, char8_t const* end) const;
+};
+
+} // namespace detail::us2f
+
+// The translation tables of u8string_to_filename / filename_to_u8string, precomputed.
+//
+// Use this when many strings must be converted with the same tables. The buffer writing
+// encode and decode do not allocate; runs of ASCII characters that need no translation
+// or escaping are found with a vectorized scan and copied as-is.
+//
+// Usage:
+//
+//   utils::FilenameTranslator const translator;        // Default tables, same as u8string_to_filename.
+//
+//   std::vector<char8_t> buf(utils::FilenameTranslator::max_size(key.size()));
+//   std::u8string_view filename(buf.data(), translator.encode(buf.data(), key) - buf.data());
+//   ...
+//   std::vector<char8_t> buf2(utils::FilenameTranslator::max_size(filename.size()));
+//   std::u8string_view key2(buf2.data(), translator.decode(buf2.data(), filename) - buf2.data());      // key2 == key.
+//
+class FilenameTranslator
+{
+ private:
+  detail::us2f::Dictionary m_illegal;
+  detail::us2f::Dictionary m_from;
+  detail::us2f::Dictionary m_to;
+  detail::us2f::SpecialByteScanner m_encode_scanner;    // The ASCII characters that encode can't just copy.
+  detail::us2f::SpecialByteScanner m_decode_scanner;    // The ASCII characters that decode can't just copy.
+
+ public:
+  // The arguments have the same meaning as those of u8string_to_filename.
+  FilenameTranslator(std::u8string_view illegal = u8"/", std::u8string_view from = u8" _/", std::u8string_view to = u8"_\u2017\u2215");
+
+  // The size of the buffer that is needed to encode or decode a string of `size` bytes.
+  // An input byte becomes at most three bytes (%XX) or a (translated) glyph of at most four bytes.
+  static constexpr size_t max_size(size_t size) { return 4 * size; }
+
+  // Write the filename of str to out, which must have room for at least max_size(str.size()) bytes.
+  // Returns a pointer one past the last byte written.
+  char8_t* encode(char8_t* out, std::u8string_view str) const;
+
+  // Write the string that was encoded as filename to out, which must have room for at least max_size(filename.size()) bytes.
+  // Returns a pointer one past the last byte written.
+  char8_t* decode(char8_t* out, std::u8string_view filename) const;
+
+  std::filesystem::path encode(std::u8string_view str) const;
+  std::u8string decode(std::u8string_view filename) const;
+};
+
 } // namespace utils
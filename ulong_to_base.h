@@ -28,24 +28,125 @@
 #pragma once
 
 #include <string>
+#include <span>
+#include <array>
+#include <bit>
+#include <limits>
+#include <cstddef>
 
 // Usage:
 //
 // std::cout << utils::ulong_to_base(n, "abcdefghijklmnopqrstuvwxyz") << std::endl;
 //
 // Converts 'n' to base 26 where 'a' = 0, 'b' = 1, ... 'z' = 25.
+//
+// To avoid the allocation of a std::string, write into a buffer instead:
+//
+// char buf[utils::ulong_to_base_max_digits<26>];
+// char* end = utils::ulong_to_base(buf, n, "abcdefghijklmnopqrstuvwxyz");
+//
+// or convert many values at once, separated by a separator character (which may be '\0'):
+//
+// std::vector<char> out(utils::ulong_to_base_max_size<62>(values.size()));
+// char* end = utils::ulong_to_base(out.data(), std::span<unsigned long const>{values}, digits62, ',');
 
 namespace utils {
 
+// The maximum number of digits that ulong_to_base can write for a single value in base `base`.
+template<int base>
+inline constexpr int ulong_to_base_max_digits = [](){
+  static_assert(base >= 2, "ulong_to_base: base must be at least 2.");
+  int digits = 1;
+  for (unsigned long n = std::numeric_limits<unsigned long>::max(); n >= base; n /= base)
+    ++digits;
+  return digits;
+}();
+
+// The size of the buffer required to convert number_of_values values in base `base` at once (including the separators).
+template<int base>
+constexpr size_t ulong_to_base_max_size(size_t number_of_values)
+{
+  return number_of_values * (ulong_to_base_max_digits<base> + 1);
+}
+
+namespace detail {
+
+// powers[k] = base^(k+1), for all powers that fit in an unsigned long.
+template<int base>
+inline constexpr auto ulong_to_base_powers = [](){
+  std::array<unsigned long, ulong_to_base_max_digits<base> - 1> powers;
+  unsigned long power = 1;
+  for (auto& p : powers)
+    p = power *= base;
+  return powers;
+}();
+
+// Return the number of digits of n in base `base`.
+template<int base>
+constexpr int ulong_to_base_digits(unsigned long n)
+{
+  if constexpr (std::has_single_bit(static_cast<unsigned int>(base)))
+  {
+    constexpr int shift = std::countr_zero(static_cast<unsigned int>(base));
+    return (std::bit_width(n | 1) + shift - 1) / shift;
+  }
+  else
+  {
+    int count = 1;
+    for (unsigned long power : ulong_to_base_powers<base>)
+    {
+      if (n < power)
+        break;
+      ++count;
+    }
+    return count;
+  }
+}
+
+} // namespace detail
+
+// Write n in base `base_plus_one - 1` to out, which must have room for at least ulong_to_base_max_digits<base_plus_one - 1> characters.
+// Returns a pointer one past the last character written (no terminating zero is written).
 template<int base_plus_one>
-std::string ulong_to_base(unsigned long n, char const (&digits) [base_plus_one])
+char* ulong_to_base(char* out, unsigned long n, char const (&digits) [base_plus_one])
 {
   int constexpr base = base_plus_one - 1;
-  char buf[8 * sizeof(n)];
-  std::string::size_type const end = sizeof(buf);
-  std::string::size_type count = 0;
-  do buf[end - ++count] = digits[n % base]; while ((n /= base));
-  return std::string(buf + end - count, count);
+  char* const end = out + detail::ulong_to_base_digits<base>(n);
+  char* p = end;
+  if constexpr (std::has_single_bit(static_cast<unsigned int>(base)))
+  {
+    // Power-of-two bases: shifts and masks.
+    constexpr int shift = std::countr_zero(static_cast<unsigned int>(base));
+    constexpr unsigned long mask = base - 1;
+    do *--p = digits[n & mask]; while ((n >>= shift));
+  }
+  else
+  {
+    // Division by a compile-time constant becomes a multiplication.
+    do *--p = digits[n % base]; while ((n /= base));
+  }
+  return end;
+}
+
+// Write all values, each followed by separator, to out, which must have room for at least
+// ulong_to_base_max_size<base_plus_one - 1>(values.size()) characters.
+// Returns a pointer one past the last character written (the last separator).
+template<int base_plus_one>
+char* ulong_to_base(char* out, std::span<unsigned long const> values, char const (&digits) [base_plus_one], char separator)
+{
+  for (unsigned long n : values)
+  {
+    out = ulong_to_base(out, n, digits);
+    *out++ = separator;
+  }
+  return out;
+}
+
+template<int base_plus_one>
+std::string ulong_to_base(unsigned long n, char const (&digits) [base_plus_one])
+{
+  char buf[ulong_to_base_max_digits<base_plus_one - 1>];
+  return std::string(buf, ulong_to_base(buf, n, digits));
 }
 
 } // namespace utils
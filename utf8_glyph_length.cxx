@@ -1,5 +1,13 @@
 #include "sys.h"
+#include "utf8_glyph_length.h"
 #include "macros.h"
+#include <cstring>
+#include <cstdint>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace utils {
 
@@ -24,4 +32,151 @@ int utf8_glyph_length(char8_t const* glyph)
   return 1 + extra;
 }
 
+namespace {
+
+#if defined(__AVX2__)
+constexpr size_t ascii_block_size = 32;
+#else
+constexpr size_t ascii_block_size = 16;
+#endif
+
+// Return true if the ascii_block_size bytes starting at p are all ASCII.
+inline bool is_ascii_block(char8_t const* p)
+{
+#if defined(__AVX2__)
+  return _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(p))) == 0;
+#elif defined(__SSE2__)
+  return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p))) == 0;
+#else
+  uint64_t w[2];
+  std::memcpy(w, p, sizeof(w));
+  return ((w[0] | w[1]) & 0x8080808080808080) == 0;
+#endif
+}
+
+// Like utf8_glyph_length, but the string ends at end (instead of being zero terminated).
+inline int utf8_glyph_length(char8_t const* glyph, char8_t const* end)
+{
+  int extra = (0x3a55000000000000 >> ((*glyph >> 2) & 0x3e)) & 0x3;
+  if (AI_UNLIKELY(extra >= end - glyph))
+    return 1;
+  int i = 0;
+  while (++i <= extra)
+    if (AI_UNLIKELY(glyph[i] >> 6 != 2))
+      return 1;
+  return 1 + extra;
+}
+
+// Return the length of the legal UTF8 glyph at glyph, or 0 if it isn't legal.
+inline int utf8_legal_glyph_length(char8_t const* glyph, char8_t const* end)
+{
+  unsigned int c0 = glyph[0];
+  if (c0 < 0x80)
+    return 1;
+  // The allowed range of the second byte depends on the first byte (see the table in RFC 3629, section 4).
+  unsigned int low = 0x80, high = 0xbf;
+  int len;
+  if (c0 < 0xc2)                        // Continuation byte or overlong two byte sequence.
+    return 0;
+  else if (c0 < 0xe0)
+    len = 2;
+  else if (c0 < 0xf0)
+  {
+    len = 3;
+    if (c0 == 0xe0)
+      low = 0xa0;                       // Overlong.
+    else if (c0 == 0xed)
+      high = 0x9f;                      // Surrogates.
+  }
+  else if (c0 < 0xf5)
+  {
+    len = 4;
+    if (c0 == 0xf0)
+      low = 0x90;                       // Overlong.
+    else if (c0 == 0xf4)
+      high = 0x8f;                      // Above U+10FFFF.
+  }
+  else
+    return 0;
+  if (end - glyph < len || glyph[1] < low || glyph[1] > high)
+    return 0;
+  for (int i = 2; i < len; ++i)
+    if (glyph[i] >> 6 != 2)
+      return 0;
+  return len;
+}
+
+} // namespace
+
+bool utf8_validate(std::u8string_view str)
+{
+  char8_t const* p = str.data();
+  char8_t const* const end = p + str.size();
+  while (p != end)
+  {
+    if (static_cast<size_t>(end - p) >= ascii_block_size && is_ascii_block(p))
+    {
+      p += ascii_block_size;
+      continue;
+    }
+    // Validate glyphs until the end of this block.
+    char8_t const* block_end = end - p > static_cast<ptrdiff_t>(ascii_block_size) ? p + ascii_block_size : end;
+    while (p < block_end)
+    {
+      int len = utf8_legal_glyph_length(p, end);
+      if (AI_UNLIKELY(len == 0))
+        return false;
+      p += len;
+    }
+  }
+  return true;
+}
+
+size_t utf8_count_glyphs(std::u8string_view str)
+{
+  size_t count = 0;
+  char8_t const* p = str.data();
+  char8_t const* const end = p + str.size();
+  while (p != end)
+  {
+    if (static_cast<size_t>(end - p) >= ascii_block_size && is_ascii_block(p))
+    {
+      p += ascii_block_size;
+      count += ascii_block_size;
+      continue;
+    }
+    char8_t const* block_end = end - p > static_cast<ptrdiff_t>(ascii_block_size) ? p + ascii_block_size : end;
+    while (p < block_end)
+    {
+      p += utf8_glyph_length(p, end);
+      ++count;
+    }
+  }
+  return count;
+}
+
+void utf8_glyph_boundaries(std::u8string_view str, std::vector<size_t>& boundaries)
+{
+  char8_t const* const begin = str.data();
+  char8_t const* p = begin;
+  char8_t const* const end = p + str.size();
+  while (p != end)
+  {
+    if (static_cast<size_t>(end - p) >= ascii_block_size && is_ascii_block(p))
+    {
+      size_t offset = p - begin;
+      for (size_t i = 0; i < ascii_block_size; ++i)
+        boundaries.push_back(offset + i);
+      p += ascii_block_size;
+      continue;
+    }
+    char8_t const* block_end = end - p > static_cast<ptrdiff_t>(ascii_block_size) ? p + ascii_block_size : end;
+    while (p < block_end)
+    {
+      boundaries.push_back(p - begin);
+      p += utf8_glyph_length(p, end);
+    }
+  }
+}
+
 } // namespace utils
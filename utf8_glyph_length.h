@@ -1,7 +1,25 @@
 #pragma once
 
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
 namespace utils {
 
 int utf8_glyph_length(char8_t const* glyph);
 
+// Bulk functions that work on a whole string (that does not need to be zero terminated).
+// They skip over runs of ASCII characters 32 (AVX2) or 16 (SSE2) bytes at a time.
+
+// Return true if str is legal UTF8 (no overlong encodings, no surrogates and nothing above U+10FFFF).
+bool utf8_validate(std::u8string_view str);
+
+// Return the number of glyphs in str.
+// This is the number of times that utf8_glyph_length would be called to step over str:
+// every byte that is not part of a legal UTF8 glyph counts as one glyph.
+size_t utf8_count_glyphs(std::u8string_view str);
+
+// Append the offset of the start of every glyph in str to boundaries (using the same definition of a glyph as utf8_count_glyphs).
+void utf8_glyph_boundaries(std::u8string_view str, std::vector<size_t>& boundaries);
+
 } // namespace utils